@@ -0,0 +1,137 @@
+/**
+ * @file arena.cpp
+ * @author Adam Hos <xhosad00>
+ * @brief Memory arena of a Simulation and allocator for standard containers
+ */
+
+#include "arena.hpp"
+
+/**********ARENA**********/
+    /**
+     * @brief Construct an empty arena, the first chunk is allocated on first use
+     *
+     * @param chunkSize size of the first chunk, every new chunk doubles it up to MAX_CHUNK
+     */
+    Arena::Arena(size_t chunkSize) : chunkSize(chunkSize), current(0), ptr(nullptr), end(nullptr), usedBytes(0)
+    {
+        for (int c = 0; c < CLASSES; c++)
+            freeList[c] = nullptr;
+    }
+
+    /**
+     * @brief Free all chunks
+     */
+    Arena::~Arena()
+    {
+        for (const Chunk& c : chunks)
+            ::operator delete(c.start);
+    }
+
+    /**
+     * @brief Size class of a block, blocks are rounded up to a power of two
+     */
+    int Arena::sizeClass(size_t size)
+    {
+        if (size <= ((size_t)1 << MIN_CLASS))
+            return MIN_CLASS;
+        return 64 - __builtin_clzll((unsigned long long)size - 1);
+    }
+
+    /**
+     * @brief Move to the next kept chunk large enough for bytes, allocate a new one if there is none
+     *
+     * @param bytes size of the block that did not fit
+     */
+    void Arena::nextChunk(size_t bytes)
+    {
+        size_t i = ptr ? current + 1 : current;
+        while (i < chunks.size() && chunks[i].size < bytes)
+            i++;
+        if (i >= chunks.size())
+        {
+            Chunk c;
+            c.size = bytes > chunkSize ? bytes : chunkSize;
+            c.start = static_cast<char*>(::operator new(c.size));
+            chunks.push_back(c);
+            if (chunkSize < MAX_CHUNK)
+                chunkSize *= 2;
+            i = chunks.size() - 1;
+        }
+        current = i;
+        ptr = chunks[i].start;
+        end = ptr + chunks[i].size;
+    }
+
+    /**
+     * @brief Allocate a block, aligned to 16 bytes
+     *
+     * @param size size of the block
+     * @return pointer to the block
+     */
+    void* Arena::allocate(size_t size)
+    {
+        int c = sizeClass(size);
+        if (freeList[c])
+        {
+            void* p = freeList[c];
+            freeList[c] = *static_cast<void**>(p);
+            return p;
+        }
+        size_t bytes = (size_t)1 << c;
+        if (!ptr || (size_t)(end - ptr) < bytes)
+            nextChunk(bytes);
+        void* p = ptr;
+        ptr += bytes;
+        usedBytes += bytes;
+        return p;
+    }
+
+    /**
+     * @brief Return a block to the free list of its size class
+     *
+     * @param p pointer to the block
+     * @param size size the block was allocated with
+     */
+    void Arena::deallocate(void* p, size_t size)
+    {
+        if (!p)
+            return;
+        int c = sizeClass(size);
+        *static_cast<void**>(p) = freeList[c];
+        freeList[c] = p;
+    }
+
+    /**
+     * @brief Drop all blocks at once, chunks are kept for later allocations
+     *
+     * Every container using the arena must be destroyed or replaced before
+     */
+    void Arena::rewind()
+    {
+        for (int c = 0; c < CLASSES; c++)
+            freeList[c] = nullptr;
+        current = 0;
+        ptr = nullptr;
+        end = nullptr;
+        usedBytes = 0;
+    }
+
+    /**
+     * @brief Bytes of all chunks
+     */
+    size_t Arena::reserved() const
+    {
+        size_t total = 0;
+        for (const Chunk& c : chunks)
+            total += c.size;
+        return total;
+    }
+
+    /**
+     * @brief Bytes cut from chunks since the last rewind, including freed blocks
+     */
+    size_t Arena::used() const
+    {
+        return usedBytes;
+    }
+/**********ARENA**********/
@@ -0,0 +1,123 @@
+/**
+ * @file arena.hpp
+ * @author Adam Hos <xhosad00>
+ * @brief Memory arena of a Simulation and allocator for standard containers
+ *
+ * The arena hands out blocks from large chunks. Freed blocks are kept in free lists by size
+ * class and reused, so long runs with steady process creation do not grow it. rewind() drops
+ * all blocks at once and keeps the chunks for the next replication
+ */
+
+#ifndef ARENA_HPP
+#define ARENA_HPP
+
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <vector>
+
+    /**
+     * @brief The Arena class is a chunked bump allocator with power of two size classes
+     */
+    class Arena
+    {
+    public:
+        explicit Arena(size_t chunkSize = 4 << 10);
+        ~Arena();
+        Arena(const Arena&) = delete;
+        Arena& operator=(const Arena&) = delete;
+
+        void* allocate(size_t size);
+        void deallocate(void* p, size_t size);
+        void rewind();
+
+        size_t reserved() const;
+        size_t used() const;
+
+    private:
+        static const int CLASSES = 48;  ///< Size class c holds blocks of 2^c bytes
+        static const int MIN_CLASS = 4; ///< Smallest block is 16 bytes
+        static const size_t MAX_CHUNK = 1 << 20;    ///< Chunks stop doubling at this size
+
+        /**
+         * @brief Chunk of memory blocks are cut from
+         */
+        struct Chunk
+        {
+            char* start;    ///< Start of the chunk
+            size_t size;    ///< Size of the chunk
+        };
+
+        size_t chunkSize;           ///< Size of the next new chunk
+        std::vector<Chunk> chunks;  ///< All chunks, kept by rewind
+        size_t current;             ///< Index of the chunk blocks are cut from
+        char* ptr;                  ///< Next free byte of the current chunk
+        char* end;                  ///< End of the current chunk
+        size_t usedBytes;           ///< Bytes cut from chunks since the last rewind
+        void* freeList[CLASSES];    ///< Freed blocks of every size class, linked through their first bytes
+
+        static int sizeClass(size_t size);
+        void nextChunk(size_t bytes);
+    };
+
+    /**
+     * @brief Allocator of standard containers taking memory from an Arena
+     *
+     * Default constructed allocator has no arena and uses operator new. Allocator follows the
+     * container on move assignment, so a container can be moved into a Simulation arena. A copy
+     * constructed container gets no arena, it never allocates from or frees into the arena of
+     * the container it was copied from, which may belong to another Simulation
+     *
+     * @tparam T allocated type
+     */
+    template <typename T>
+    class ArenaAllocator
+    {
+    public:
+        typedef T value_type;
+        typedef std::true_type propagate_on_container_move_assignment;
+        typedef std::true_type propagate_on_container_swap;
+
+        Arena* arena;   ///< Arena of the allocator, nullptr to use operator new
+
+        ArenaAllocator(Arena* a = nullptr) noexcept : arena(a) {}
+        template <typename U>
+        ArenaAllocator(const ArenaAllocator<U>& other) noexcept : arena(other.arena) {}
+
+        /**
+         * @brief Allocator of a copy constructed container, uses operator new
+         */
+        ArenaAllocator select_on_container_copy_construction() const noexcept
+        {
+            return ArenaAllocator();
+        }
+
+        T* allocate(size_t n)
+        {
+            if (arena)
+                return static_cast<T*>(arena->allocate(n * sizeof(T)));
+            return static_cast<T*>(::operator new(n * sizeof(T)));
+        }
+
+        void deallocate(T* p, size_t n)
+        {
+            if (arena)
+                arena->deallocate(p, n * sizeof(T));
+            else
+                ::operator delete(p);
+        }
+    };
+
+    template <typename T, typename U>
+    bool operator==(const ArenaAllocator<T>& a, const ArenaAllocator<U>& b)
+    {
+        return a.arena == b.arena;
+    }
+
+    template <typename T, typename U>
+    bool operator!=(const ArenaAllocator<T>& a, const ArenaAllocator<U>& b)
+    {
+        return a.arena != b.arena;
+    }
+
+#endif // ARENA_HPP
@@ -0,0 +1,743 @@
+/**
+ * @file bench.cpp
+ * @author Adam Hos <xhosad00>
+ * @brief Benchmarks of the discreteSim library
+ *
+ * Results are printed to stdout as CSV rows: benchmark,case,metric,value
+ * where case is a ';' separated list of benchmark parameters. Benchmarks:
+ *  - model_load: loading of a generated model file
+ *  - distribution: sampling throughput of every distribution type
+ *  - calendar: hold operations on the Calendar alone, without dispatch
+ *  - hold: classic hold model, fixed number of pending events
+ *  - mmc: M/M/1 and M/M/c queue at several loads
+ *  - timeseries: M/M/1 with facility time series recorded by the background writer
+ *  - trace: replay of a generated arrival trace through one facility
+ *  - tandem: long line of single server facilities
+ *  - phold: PHOLD with processes as logical processes, run on the sequential engine
+ *  - channel: producers and one consumer passing messages through a Channel
+ *  - splitting: rare M/M/1 queue overflow by fixed effort splitting, against the cost of plain runs
+ *  - replications: back-to-back short M/M/1 replications, new Simulation each time vs. Simulation::reset
+ *  - ensemble: replications of a tandem line, one Simulation per replication vs. lockstep Ensemble
+ */
+
+#include "channel.hpp"
+#include "discreteSim.hpp"
+#include "ensemble.hpp"
+#include "modelLoader.hpp"
+#include "splitting.hpp"
+#include "traceSource.hpp"
+
+#include <chrono>
+#include <cmath>
+#include <climits>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <string>
+
+const bool Verbose = false;
+
+static size_t liveBytes = 0;    ///< Bytes currently allocated through operator new
+static size_t peakBytes = 0;    ///< Highest value of liveBytes since last reset
+static size_t allocCount = 0;   ///< Number of calls of operator new
+
+/**
+ * @brief Counting replacement of the global operator new
+ * 
+ * Allocation size is stored in front of the block so delete can update the counters
+ */
+void* operator new(size_t size)
+{
+    void* p = malloc(size + 16);
+    if (!p)
+        throw std::bad_alloc();
+    *static_cast<size_t*>(p) = size;
+    liveBytes += size;
+    allocCount++;
+    if (liveBytes > peakBytes)
+        peakBytes = liveBytes;
+    return static_cast<char*>(p) + 16;
+}
+
+void operator delete(void* p) noexcept
+{
+    if (!p)
+        return;
+    char* block = static_cast<char*>(p) - 16;
+    liveBytes -= *reinterpret_cast<size_t*>(block);
+    free(block);
+}
+
+/**
+ * @brief Seconds elapsed since start
+ */
+static double secondsSince(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+/**
+ * @brief Print one result row
+ */
+static void report(const char* bench, const std::string& params, const char* metric, double value)
+{
+    printf("%s,%s,%s,%.6g\n", bench, params.c_str(), metric, value);
+    fflush(stdout);
+}
+
+/**
+ * @brief Measure loading of a generated model with many facilities and sources
+ *
+ * @param facilities number of facilities in the model
+ */
+static void benchModelLoad(int facilities)
+{
+    std::string text;
+    text.reserve(facilities * 48);
+    char line[128];
+    for (int i = 0; i < facilities; i++)
+    {
+        snprintf(line, sizeof(line), "facility %d F%d %d exp %g 0\n", i, i, 1 + i % 4, 1.0 + (i % 10) * 0.1);
+        text += line;
+    }
+    for (int i = 0; i < facilities / 100; i++)
+    {
+        snprintf(line, sizeof(line), "source %d exp 0.5 0\nroute %d %d %d %d\n", i, i, i, (i * 7) % facilities, (i * 13) % facilities);
+        text += line;
+    }
+
+    Simulation sim;
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    bool ok = loadModelString(&sim, text.data(), text.size(), "bench");
+    double elapsed = secondsSince(start);
+    if (!ok)
+    {
+        std::cerr << "model_load failed\n";
+        return;
+    }
+    std::string params = "facilities=" + std::to_string(facilities);
+    report("model_load", params, "seconds", elapsed);
+    report("model_load", params, "bytes", text.size());
+}
+
+static volatile double sampleSink;  ///< Keeps sampled values alive
+
+/**
+ * @brief Sampling throughput of a precomputed distribution
+ *
+ * @param name distribution case name
+ * @param d distribution
+ * @param samples number of samples
+ */
+static void benchDistribution(const std::string& name, Distribution d, long samples)
+{
+    double sum = 0;
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (long i = 0; i < samples; i++)
+        sum += d.sample();
+    double seconds = secondsSince(start);
+    sampleSink = sum;
+    report("distribution", name, "samples_per_sec", samples / seconds);
+}
+
+/**
+ * @brief Sampling throughput of Facility::generateTime(g, a, b), which builds the distribution per call
+ */
+static void benchDistributionPerCall(const std::string& name, Facility::GenType g, double a, double b, long samples)
+{
+    double sum = 0;
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (long i = 0; i < samples; i++)
+        sum += Facility::generateTime(g, a, b);
+    double seconds = secondsSince(start);
+    sampleSink = sum;
+    report("distribution", name + ";per_call", "samples_per_sec", samples / seconds);
+}
+
+/**
+ * @brief Run the simulation until it finishes or maxEvents events are executed
+ *
+ * @param sim simulation to run
+ * @param maxEvents maximal number of executed events
+ * @return number of executed events
+ */
+static long runEvents(Simulation& sim, long maxEvents)
+{
+    long n = 0;
+    while (n < maxEvents && !sim.finished())
+    {
+        Event e = sim.nextEvent();
+        sim.executeEvent(e);
+        n++;
+    }
+    return n;
+}
+
+/**
+ * @brief Report throughput and memory of a finished run
+ */
+static void reportRun(const char* bench, const std::string& params, const Simulation& sim, long events, double seconds, size_t baseBytes)
+{
+    report(bench, params, "events", events);
+    report(bench, params, "fast_lane_events", sim.calendar.fastLaneEvents());
+    report(bench, params, "seconds", seconds);
+    report(bench, params, "events_per_sec", events / seconds);
+    report(bench, params, "peak_bytes", peakBytes - baseBytes);
+}
+
+/**
+ * @brief Hold operations (take first event, plan it again later) on the calendar alone
+ *
+ * @param pending number of pending events
+ * @param holds number of measured hold operations
+ */
+static void benchCalendar(int pending, long holds)
+{
+    std::string params = "pending=" + std::to_string(pending);
+    Calendar cal;
+    for (int i = 0; i < pending; i++)
+        cal.emplace(i, 0, IgnoreID, toSimTime(expDis(1.0)), ACTIVATE_PROCESS_PRIO, 0);
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (long i = 0; i < holds; i++)
+    {
+        Event e = cal.top();
+        cal.pop();
+        cal.emplace(e.processID, 0, IgnoreID, addSimTime(e.startTime, toSimDelay(expDis(1.0))), ACTIVATE_PROCESS_PRIO, e.startTime);
+    }
+    double elapsed = secondsSince(start);
+    report("calendar", params, "holds_per_sec", holds / elapsed);
+}
+
+static Distribution* holdDist;      ///< Increment distribution of the hold benchmark, built once per run
+
+/**
+ * @brief Hold model process, reschedules itself after a random increment
+ */
+static void holdBehavior(Process* p, void* data)
+{
+    double inc = holdDist->sample();
+    p->sim->waitFor(p->id, 0, inc < 0 ? 0 : inc);
+}
+
+/**
+ * @brief Classic hold model: calendar keeps a constant number of pending events
+ *
+ * @param pending number of pending events (processes)
+ * @param g increment distribution
+ * @param a first distribution parameter
+ * @param b second distribution parameter
+ * @param genName name of the distribution used in results
+ * @param holds number of measured hold operations
+ */
+static void benchHold(int pending, Facility::GenType g, double a, double b, const char* genName, long holds)
+{
+    std::string params = "pending=" + std::to_string(pending) + ";inc=" + genName;
+    Distribution dist(g, a, b);
+    holdDist = &dist;
+
+    // memory of the calendar alone
+    {
+        Simulation sim;
+        size_t base = liveBytes;
+        for (int i = 0; i < pending; i++)
+            sim.addEvent(i, 0, IgnoreID, dist.sample(), ACTIVATE_PROCESS_PRIO, 0);
+        report("hold", params, "bytes_per_pending_event", double(liveBytes - base) / pending);
+    }
+
+    Simulation sim;
+    size_t base = liveBytes;
+    peakBytes = liveBytes;
+    for (int i = 0; i < pending; i++)
+        sim.createProcessDelayed(dist.sample(), holdBehavior);
+    report("hold", params, "bytes_per_pending_process", double(liveBytes - base) / pending);
+    runEvents(sim, pending); // warm up, every process holds once
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    long events = runEvents(sim, holds);
+    reportRun("hold", params, sim, events, secondsSince(start), base);
+}
+
+/**
+ * @brief M/M/c queue fed by an exponential arrival source
+ *
+ * @param servers number of servers (facility capacity)
+ * @param load utilization of the servers
+ * @param customers approximate number of served customers
+ * @param instrumented run with engine instrumentation enabled
+ */
+static void benchMMc(int servers, double load, int customers, bool instrumented = false)
+{
+    std::string params = "c=" + std::to_string(servers) + ";rho=" + std::to_string(load).substr(0, 4);
+    if (instrumented)
+        params += ";instr=1";
+    const double mu = 1.0;
+    double lambda = load * servers * mu;
+
+    Simulation sim;
+    size_t base = liveBytes;
+    peakBytes = liveBytes;
+    sim.createFacility(0, "Server", servers, Facility::GenType::Exp, mu, 0);
+    sim.createArrivalSource(0, Facility::GenType::Exp, lambda, 0);
+    sim.findArrivalSource(0)->route.push_back(0);
+    sim.setEndTime(customers / lambda);
+    if (instrumented)
+        sim.enableInstrumentation();
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    long events = runEvents(sim, LONG_MAX);
+    reportRun("mmc", params, sim, events, secondsSince(start), base);
+    if (instrumented)
+    {
+        Instrumentation* instr = sim.getInstrumentation();
+        report("mmc", params, "dispatch_mean_ns", instr->dispatch.mean());
+        report("mmc", params, "behavior_mean_ns", instr->behavior.mean());
+        report("mmc", params, "peak_calendar", instr->peakCalendar);
+    }
+}
+
+/**
+ * @brief M/M/1 queue recording facility time series to a temporary file
+ *
+ * @param interval simulated time between samples
+ * @param format output file format
+ * @param formatName name of the format used in results
+ * @param customers approximate number of served customers
+ */
+static void benchTimeSeries(double interval, TimeSeriesWriter::Format format, const char* formatName, int customers)
+{
+    std::string params = "interval=" + std::to_string(interval).substr(0, 4) + ";format=" + formatName;
+    const double lambda = 0.8;
+    const char* path = "bench_timeseries.tmp";
+
+    Simulation sim;
+    size_t base = liveBytes;
+    peakBytes = liveBytes;
+    sim.createFacility(0, "Server", 1, Facility::GenType::Exp, 1.0, 0);
+    sim.createArrivalSource(0, Facility::GenType::Exp, lambda, 0);
+    sim.findArrivalSource(0)->route.push_back(0);
+    sim.setEndTime(customers / lambda);
+    TimeSeriesWriter writer(path, format);
+    sim.recordTimeSeries(&writer, interval);
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    long events = runEvents(sim, LONG_MAX);
+    reportRun("timeseries", params, sim, events, secondsSince(start), base);
+    writer.close();
+    report("timeseries", params, "samples_written", writer.written());
+    report("timeseries", params, "samples_dropped", writer.dropped());
+    remove(path);
+}
+
+static TraceSource* benchTraceSrc;   ///< Trace replayed by traceJobBehavior
+
+/**
+ * @brief Process replayed from a trace, seizes the facility given by its first attribute
+ */
+static void traceJobBehavior(Process* p, void* data)
+{
+    if (p->state == 0)
+        p->seize((int)benchTraceSrc->attribute(p->data, 0), 1);
+    else
+        p->sim->terminateProcess(p->id);
+}
+
+/**
+ * @brief Replay of a generated Poisson arrival trace through an M/M/1 queue
+ *
+ * @param records number of records in the trace
+ * @param binary write the trace in binary format instead of CSV
+ */
+static void benchTrace(int records, bool binary)
+{
+    std::string params = "records=" + std::to_string(records) + ";format=" + (binary ? "binary" : "csv");
+    const char* path = "bench_trace.tmp";
+    FILE* f = fopen(path, "wb");
+    if (!f)
+        return;
+    if (binary)
+    {
+        uint32_t header[2] = {1, 0};
+        fwrite("SHOTR001", 1, 8, f);
+        fwrite(header, sizeof(uint32_t), 2, f);
+    }
+    else
+        fputs("time,facility\n", f);
+    double t = 0;
+    for (int i = 0; i < records; i++)
+    {
+        t += expDis(0.8);
+        if (binary)
+        {
+            double rec[2] = {t, 0};
+            fwrite(rec, sizeof(double), 2, f);
+        }
+        else
+            fprintf(f, "%.6f,0\n", t);
+    }
+    fclose(f);
+
+    Simulation sim;
+    sim.createFacility(0, "Server", 1, Facility::GenType::Exp, 1.0, 0);
+    size_t base = liveBytes;
+    peakBytes = liveBytes;
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    {
+        TraceSource trace(path);
+        benchTraceSrc = &trace;
+        trace.start(&sim, traceJobBehavior);
+        report("trace", params, "startup_seconds", secondsSince(start));
+
+        start = std::chrono::steady_clock::now();
+        long events = runEvents(sim, LONG_MAX);
+        reportRun("trace", params, sim, events, secondsSince(start), base);
+        report("trace", params, "arrivals", trace.arrivals());
+    }
+    remove(path);
+}
+
+/**
+ * @brief Tandem line of single server facilities built on seizeFacility
+ *
+ * @param length number of facilities in the line
+ * @param load utilization of every facility
+ * @param customers approximate number of customers entering the line
+ */
+static void benchTandem(int length, double load, int customers)
+{
+    std::string params = "length=" + std::to_string(length) + ";rho=" + std::to_string(load).substr(0, 4);
+    const double mu = 1.0;
+    double lambda = load * mu;
+
+    Simulation sim;
+    size_t base = liveBytes;
+    peakBytes = liveBytes;
+    sim.createArrivalSource(0, Facility::GenType::Exp, lambda, 0);
+    ArrivalSource* src = sim.findArrivalSource(0);
+    for (int i = 0; i < length; i++)
+    {
+        sim.createFacility(i, "Stage", 1, Facility::GenType::Exp, mu, 0);
+        src->route.push_back(i);
+    }
+    sim.setEndTime(customers / lambda);
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    long events = runEvents(sim, LONG_MAX);
+    reportRun("tandem", params, sim, events, secondsSince(start), base);
+}
+
+static std::vector<int> pholdLPs;   ///< Process IDs of the PHOLD logical processes
+static double pholdLookahead;       ///< Minimal delay of a PHOLD message
+
+/**
+ * @brief PHOLD logical process, every received event sends one event to a random logical process
+ */
+static void pholdBehavior(Process* p, void* data)
+{
+    int target = (int)uniformDis(0, (double)pholdLPs.size());
+    if (target >= (int)pholdLPs.size())
+        target = pholdLPs.size() - 1;
+    p->sim->waitFor(pholdLPs[target], 0, pholdLookahead + expDis(1.0));
+}
+
+/**
+ * @brief PHOLD benchmark
+ *
+ * There is no parallel engine yet, so the model runs on the sequential Simulation
+ * and measures the calendar and dispatch path under PHOLD event pattern
+ *
+ * @param lps number of logical processes
+ * @param population initial events per logical process
+ * @param lookahead minimal delay of a message
+ * @param eventCnt number of measured events
+ */
+static void benchPhold(int lps, int population, double lookahead, long eventCnt)
+{
+    std::string params = "lps=" + std::to_string(lps) + ";population=" + std::to_string(population) + ";lookahead=" + std::to_string(lookahead).substr(0, 4);
+    pholdLookahead = lookahead;
+
+    Simulation sim;
+    size_t base = liveBytes;
+    peakBytes = liveBytes;
+    for (int i = 0; i < lps; i++)
+        sim.createProcessDelayed(expDis(1.0), pholdBehavior);
+    pholdLPs.clear();
+    for (auto& i : sim.procMap)
+        pholdLPs.push_back(i.first);
+    for (int i = 0; i < lps; i++)
+        for (int j = 1; j < population; j++)
+            sim.waitFor(pholdLPs[i], 0, expDis(1.0));
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    long events = runEvents(sim, eventCnt);
+    reportRun("phold", params, sim, events, secondsSince(start), base);
+}
+
+/**
+ * @brief Replications of a tandem line run one by one on Simulation and together on Ensemble
+ *
+ * @param replications number of replications
+ * @param length number of facilities in the line
+ * @param load utilization of every facility
+ * @param customers approximate number of customers entering the line in one replication
+ */
+static void benchEnsemble(int replications, int length, double load, int customers)
+{
+    std::string params = "replications=" + std::to_string(replications) + ";length=" + std::to_string(length) + ";rho=" + std::to_string(load).substr(0, 4);
+    const double mu = 1.0;
+    double lambda = load * mu;
+    double endTime = customers / lambda;
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (int r = 0; r < replications; r++)
+    {
+        Simulation sim;
+        sim.createArrivalSource(0, Facility::GenType::Exp, lambda, 0);
+        ArrivalSource* src = sim.findArrivalSource(0);
+        for (int i = 0; i < length; i++)
+        {
+            sim.createFacility(i, "Stage", 1, Facility::GenType::Exp, mu, 0);
+            src->route.push_back(i);
+        }
+        sim.setEndTime(endTime);
+        runEvents(sim, LONG_MAX);
+    }
+    double seconds = secondsSince(start);
+    report("ensemble", params + ";engine=simulation", "replications_per_sec", replications / seconds);
+
+    Ensemble ens(replications);
+    ens.setArrivals(Facility::GenType::Exp, lambda, 0);
+    for (int i = 0; i < length; i++)
+        ens.addStage(1, Facility::GenType::Exp, mu, 0);
+    start = std::chrono::steady_clock::now();
+    ens.run(endTime);
+    seconds = secondsSince(start);
+    report("ensemble", params + ";engine=ensemble", "replications_per_sec", replications / seconds);
+}
+
+static Channel<long>* benchChan;    ///< Channel of the channel benchmark
+static long benchChanValue;         ///< Message received by the consumer
+
+/**
+ * @brief Producer sending messages back to back
+ */
+static void chanProducerBehavior(Process* p, void* data)
+{
+    benchChan->send(p, p->id, 0);
+}
+
+/**
+ * @brief Consumer receiving messages back to back
+ */
+static void chanConsumerBehavior(Process* p, void* data)
+{
+    benchChan->receive(p, 0, &benchChanValue);
+}
+
+/**
+ * @brief Message passing throughput, allocations are counted only after a warm-up
+ *
+ * @param producers number of producers
+ * @param capacity channel capacity, -1 if unbounded
+ * @param eventCnt number of measured events
+ */
+static void benchChannel(int producers, int capacity, long eventCnt)
+{
+    std::string params = "producers=" + std::to_string(producers) + ";capacity=" + std::to_string(capacity);
+    Simulation sim;
+    Channel<long> c(&sim, capacity);
+    benchChan = &c;
+    for (int i = 0; i < producers; i++)
+        sim.createProcess(chanProducerBehavior);
+    sim.createProcess(chanConsumerBehavior);
+    runEvents(sim, 100000);
+
+    size_t allocs = allocCount;
+    unsigned long received = c.receivedCount();
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    runEvents(sim, eventCnt);
+    double seconds = secondsSince(start);
+    report("channel", params, "messages_per_sec", (c.receivedCount() - received) / seconds);
+    report("channel", params, "steady_allocations", allocCount - allocs);
+}
+
+/**
+ * @brief Fixed effort splitting of a rare queue overflow
+ *
+ * Plain runs needed for the same relative error are computed from the estimate and the
+ * measured mean number of events of a plain run
+ *
+ * @param length queue length of the rare event
+ * @param step distance of splitting levels
+ * @param effort runs per stage
+ */
+static void benchSplitting(int length, int step, int effort)
+{
+    std::string params = "rho=0.50;length=" + std::to_string(length) + ";effort=" + std::to_string(effort);
+    const double horizon = 100;
+    Simulation initial;
+    initial.createArrivalSource(0, Facility::GenType::Exp, 0.5, 0);
+    initial.createFacility(0, "Queue", 1, Facility::GenType::Exp, 1.0, 0);
+    initial.findArrivalSource(0)->route.push_back(0);
+    initial.setEndTime(horizon);
+
+    const int plainRuns = 1000;
+    long plainEvents = 0;
+    Simulation run;
+    for (int i = 0; i < plainRuns; i++)
+    {
+        run = initial;
+        runUntilQueue(run, run.findFacility(0), length, plainEvents);
+    }
+
+    std::vector<int> levels;
+    for (int l = step; l <= length; l += step)
+        levels.push_back(l);
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    SplittingResult res = fixedEffortSplitting(initial, 0, levels, horizon, effort, 10);
+    double seconds = secondsSince(start);
+
+    double p = res.probability;
+    double relErr = p > 0 ? std::sqrt(res.variance) / p : 0;
+    report("splitting", params, "probability", p);
+    report("splitting", params, "relative_error", relErr);
+    report("splitting", params, "events", res.events);
+    report("splitting", params, "seconds", seconds);
+    if (p > 0 && relErr > 0)
+    {
+        double plainNeeded = (1 - p) / (p * relErr * relErr);
+        report("splitting", params, "plain_runs_needed", plainNeeded);
+        report("splitting", params, "plain_events_needed", plainNeeded * plainEvents / plainRuns);
+        report("splitting", params, "event_speedup", plainNeeded * plainEvents / plainRuns / res.events);
+    }
+}
+
+/**
+ * @brief Build M/M/1 model with a source and one facility in an empty simulation
+ */
+static void buildMM1(Simulation& sim, double load, double endTime)
+{
+    sim.createArrivalSource(0, Facility::GenType::Exp, load, 0);
+    sim.createFacility(0, "Queue", 1, Facility::GenType::Exp, 1.0, 0);
+    sim.findArrivalSource(0)->route.push_back(0);
+    sim.setEndTime(endTime);
+}
+
+/**
+ * @brief Back-to-back short replications
+ *
+ * @param replications number of replications
+ * @param customers approximate number of customers of one replication
+ * @param reuse true to reset one Simulation between replications, false to construct a new one
+ */
+static void benchReplications(int replications, int customers, bool reuse)
+{
+    std::string params = "customers=" + std::to_string(customers) + ";mode=" + (reuse ? "reset" : "new");
+    const double load = 0.8;
+    size_t allocs = allocCount;
+    long events = 0;
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    if (reuse)
+    {
+        Simulation sim;
+        for (int r = 0; r < replications; r++)
+        {
+            sim.reset();
+            buildMM1(sim, load, customers / load);
+            events += runEvents(sim, LONG_MAX);
+        }
+    }
+    else
+    {
+        for (int r = 0; r < replications; r++)
+        {
+            Simulation sim;
+            buildMM1(sim, load, customers / load);
+            events += runEvents(sim, LONG_MAX);
+        }
+    }
+    double seconds = secondsSince(start);
+    report("replications", params, "replications_per_sec", replications / seconds);
+    report("replications", params, "events_per_sec", events / seconds);
+    report("replications", params, "allocations_per_replication", (double)(allocCount - allocs) / replications);
+}
+
+int main(int argc, char* argv[])
+{
+    if (parseArguments(argc, argv, SEED))
+        return 1;
+
+    printf("benchmark,case,metric,value\n");
+    benchModelLoad(1000);
+    benchModelLoad(100000);
+
+    const long samples = 5000000;
+    benchDistribution("uniform", Distribution(GenType::Uniform, 0, 2.0), samples);
+    benchDistribution("exp", Distribution(GenType::Exp, 1.0, 0), samples);
+    benchDistribution("normal", Distribution(GenType::Normal, 1.0, 0.2), samples);
+    benchDistribution("det", Distribution(GenType::Deterministic, 1.0, 0), samples);
+    benchDistribution("erlang;k=4", Distribution(GenType::Erlang, 4, 4.0), samples);
+    benchDistribution("lognormal", Distribution(GenType::LogNormal, 0, 0.5), samples);
+    benchDistribution("hyperexp;branches=2", Distribution::hyperExp({0.9, 0.1}, {1.8, 0.2}), samples);
+    benchDistribution("phase;branches=2", Distribution::phaseType({0.6, 0.4}, {2, 5}, {3.0, 1.0}), samples);
+    const int binCounts[] = {10, 10000};
+    for (int bins : binCounts)
+    {
+        std::vector<double> edges(bins + 1), weights(bins);
+        for (int i = 0; i <= bins; i++)
+            edges[i] = i;
+        for (int i = 0; i < bins; i++)
+            weights[i] = uniformDis(0, 1);
+        benchDistribution("empirical;bins=" + std::to_string(bins), Distribution::empirical(edges, weights), samples);
+        benchDistribution("discrete;values=" + std::to_string(bins), Distribution::discrete(edges, std::vector<double>(edges.size(), 1.0)), samples);
+    }
+    benchDistributionPerCall("exp", Facility::GenType::Exp, 1.0, 0, samples);
+    benchDistributionPerCall("normal", Facility::GenType::Normal, 1.0, 0.2, samples);
+
+    const long holds = 1000000;
+    const int holdSizes[] = {10, 1000, 100000};
+    for (int n : holdSizes)
+        benchCalendar(n, holds);
+    benchCalendar(1000000, holds);
+    for (int n : holdSizes)
+    {
+        benchHold(n, Facility::GenType::Exp, 1.0, 0, "exp", holds);
+        benchHold(n, Facility::GenType::Uniform, 0, 2.0, "uniform", holds);
+        benchHold(n, Facility::GenType::Normal, 1.0, 0.2, "normal", holds);
+    }
+
+    const double loads[] = {0.5, 0.8, 0.95};
+    for (double rho : loads)
+    {
+        benchMMc(1, rho, 200000);
+        benchMMc(8, rho, 200000);
+    }
+    benchMMc(1, 0.8, 200000, true);
+    benchTimeSeries(10.0, TimeSeriesWriter::Format::CSV, "csv", 200000);
+    benchTimeSeries(1.0, TimeSeriesWriter::Format::Binary, "binary", 200000);
+
+    benchTrace(1000, false);
+    benchTrace(1000000, false);
+    benchTrace(1000000, true);
+
+    benchTandem(10, 0.8, 50000);
+    benchTandem(100, 0.8, 5000);
+
+    benchPhold(64, 16, 0.1, 1000000);
+    benchPhold(1024, 16, 0.1, 1000000);
+
+    benchChannel(1, 16, 1000000);
+    benchChannel(16, 16, 1000000);
+    benchChannel(16, 0, 1000000);
+
+    benchSplitting(24, 3, 500);
+
+    benchReplications(20000, 50, false);
+    benchReplications(20000, 50, true);
+    benchReplications(2000, 1000, false);
+    benchReplications(2000, 1000, true);
+
+    benchEnsemble(64, 10, 0.8, 10000);
+    benchEnsemble(1024, 3, 0.8, 2000);
+    return 0;
+}
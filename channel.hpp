@@ -0,0 +1,261 @@
+/**
+ * @file channel.hpp
+ * @author Adam Hos <xhosad00>
+ * @brief Typed message channels between processes
+ *
+ * A Channel is a FIFO mailbox shared by any number of senders and receivers, one Channel per
+ * process serves as its private mailbox. Calls follow Process::seize: the calling process
+ * returns from its behavior and is activated in nextState once the call completes, either
+ * at the current time or after it was unblocked. A blocked process is woken by one activation
+ * event of the process that unblocked it, there is no polling. Messages, blocked senders and
+ * blocked receivers are kept in rings that only grow, so steady state messaging does not allocate
+ */
+
+#ifndef CHANNEL_HPP
+#define CHANNEL_HPP
+
+#include "discreteSim.hpp"
+
+    /**
+     * @brief Growable FIFO ring, storage is kept when elements are removed
+     *
+     * @tparam U element type, default constructible and assignable
+     */
+    template <typename U>
+    class MessageRing
+    {
+    public:
+        MessageRing() : head(0), count(0) {}
+
+        bool empty() const { return count == 0; }
+        size_t size() const { return count; }
+        U& front() { return buf[head]; }
+
+        /**
+         * @brief Append element, doubles the storage if full
+         */
+        void push(const U& v)
+        {
+            if (count == buf.size())
+                grow();
+            buf[(head + count) & (buf.size() - 1)] = v;
+            count++;
+        }
+
+        /**
+         * @brief Remove the first element
+         */
+        void pop()
+        {
+            head = (head + 1) & (buf.size() - 1);
+            count--;
+        }
+
+    private:
+        std::vector<U> buf;     ///< Storage, size is zero or a power of two
+        size_t head;            ///< Index of the first element
+        size_t count;           ///< Number of elements
+
+        void grow()
+        {
+            std::vector<U> next(buf.empty() ? 8 : buf.size() * 2);
+            for (size_t i = 0; i < count; i++)
+                next[i] = buf[(head + i) & (buf.size() - 1)];
+            buf.swap(next);
+            head = 0;
+        }
+    };
+
+    /**
+     * @brief The Channel class passes messages of type T between processes
+     *
+     * With capacity -1 the channel is unbounded and send never blocks, otherwise send blocks
+     * while capacity messages are buffered, capacity 0 makes every send wait for a receiver.
+     * Processes terminated while blocked are skipped. The Channel must outlive processes
+     * blocked on it
+     *
+     * @tparam T message type, default constructible and assignable
+     */
+    template <typename T>
+    class Channel
+    {
+    public:
+        /**
+         * @brief Construct an empty channel
+         *
+         * @param sim simulation of the communicating processes
+         * @param capacity maximal number of buffered messages, -1 if unbounded
+         */
+        Channel(Simulation* sim, int capacity = -1) : sim(sim), cap(capacity), sent(0), received(0) {}
+
+        /**
+         * @brief Send message, the sender is activated in nextState when the message is accepted
+         *
+         * @param p sending process
+         * @param msg message
+         * @param nextState state of the sender after the message is accepted
+         * @return true if accepted now, false if the sender is blocked
+         */
+        bool send(Process* p, const T& msg, int nextState)
+        {
+            sent++;
+            if (deliver(msg))
+            {
+                sim->activate(p->id, nextState);
+                return true;
+            }
+            if (cap < 0 || (int)buffer.size() < cap)
+            {
+                buffer.push(msg);
+                sim->activate(p->id, nextState);
+                return true;
+            }
+            BlockedSender s = {p->id, nextState, msg};
+            senders.push(s);
+            return false;
+        }
+
+        /**
+         * @brief Receive message, the receiver is activated in nextState with the message in *into
+         *
+         * @param p receiving process
+         * @param nextState state of the receiver after the message is received
+         * @param into where the message is stored, e.g. a field of the process data, nullptr to drop it
+         * @return true if received now, false if the receiver is blocked
+         */
+        bool receive(Process* p, int nextState, T* into)
+        {
+            if (buffer.empty() && !takeSender())
+            {
+                BlockedReceiver r = {p->id, nextState, into};
+                receivers.push(r);
+                return false;
+            }
+            if (into)
+                *into = buffer.front();
+            buffer.pop();
+            received++;
+            // free slot goes to the first blocked sender
+            if (cap < 0 || (int)buffer.size() < cap)
+                takeSender();
+            sim->activate(p->id, nextState);
+            return true;
+        }
+
+        /**
+         * @brief Number of buffered messages
+         */
+        size_t size() const { return buffer.size(); }
+
+        /**
+         * @brief Maximal number of buffered messages, -1 if unbounded
+         */
+        int capacity() const { return cap; }
+
+        /**
+         * @brief Number of processes blocked in send
+         *
+         * Processes terminated while blocked are counted until the channel skips them
+         */
+        size_t blockedSenders() const { return senders.size(); }
+
+        /**
+         * @brief Number of processes blocked in receive
+         *
+         * Processes terminated while blocked are counted until the channel skips them
+         */
+        size_t blockedReceivers() const { return receivers.size(); }
+
+        /**
+         * @brief Number of send calls
+         */
+        unsigned long sentCount() const { return sent; }
+
+        /**
+         * @brief Number of received messages
+         */
+        unsigned long receivedCount() const { return received; }
+
+    private:
+        /**
+         * @brief Sender waiting for a free slot, with its message
+         */
+        struct BlockedSender
+        {
+            int processID;          ///< The ID of the sender
+            int processNextState;   ///< The state of the sender after the message is accepted
+            T msg;                  ///< The message
+        };
+        /**
+         * @brief Receiver waiting for a message
+         */
+        struct BlockedReceiver
+        {
+            int processID;          ///< The ID of the receiver
+            int processNextState;   ///< The state of the receiver after the message is received
+            T* into;                ///< Destination of the message
+        };
+
+        Simulation* sim;                            ///< Simulation of the communicating processes
+        int cap;                                    ///< Maximal number of buffered messages, -1 if unbounded
+        MessageRing<T> buffer;                      ///< Buffered messages
+        MessageRing<BlockedSender> senders;         ///< Blocked senders in blocking order
+        MessageRing<BlockedReceiver> receivers;     ///< Blocked receivers in blocking order
+        unsigned long sent;                         ///< Number of send calls
+        unsigned long received;                     ///< Number of received messages
+
+        /**
+         * @brief Check if a blocked process still exists
+         */
+        bool alive(int processID)
+        {
+            return sim->procMap.find(processID) != sim->procMap.end();
+        }
+
+        /**
+         * @brief Hand message directly to the first blocked receiver
+         *
+         * @return false if no receiver is blocked
+         */
+        bool deliver(const T& msg)
+        {
+            while (!receivers.empty())
+            {
+                BlockedReceiver r = receivers.front();
+                receivers.pop();
+                if (!alive(r.processID))
+                    continue;
+                if (r.into)
+                    *r.into = msg;
+                received++;
+                sim->activate(r.processID, r.processNextState);
+                return true;
+            }
+            return false;
+        }
+
+        /**
+         * @brief Move message of the first blocked sender into the buffer and wake the sender
+         *
+         * @return false if no sender is blocked
+         */
+        bool takeSender()
+        {
+            while (!senders.empty())
+            {
+                BlockedSender& s = senders.front();
+                if (!alive(s.processID))
+                {
+                    senders.pop();
+                    continue;
+                }
+                buffer.push(s.msg);
+                sim->activate(s.processID, s.processNextState);
+                senders.pop();
+                return true;
+            }
+            return false;
+        }
+    };
+
+#endif // CHANNEL_HPP
@@ -8,6 +8,8 @@
 
 #include "discreteSim.hpp"
 
+#include <cstring>
+
 unsigned int SEED = 0; 
 // TODo parse from args? gen seed at random
 
@@ -54,10 +56,9 @@ unsigned int SEED = 0;
      */
 double uniformDis(double a, double b)
 {
-    static std::default_random_engine gen(SEED);
     std::uniform_real_distribution<double> dis(a, b);
 
-    return dis(gen);
+    return dis(randomEngine());
     }
     /**
      * @brief Generates a random number from an exponential distribution with parameter lambda
@@ -67,10 +68,9 @@ double uniformDis(double a, double b)
      */
     double expDis(double lambd)
     {
-        static std::default_random_engine gen(SEED);
         std::exponential_distribution<double> dis(lambd);
 
-        return dis(gen);
+        return dis(randomEngine());
     }
     /**
      * @brief Generates a random number from a normal distribution with specified mean and standard deviation
@@ -81,9 +81,8 @@ double uniformDis(double a, double b)
      */
     double normalDis(double mean, double stddev)
     {
-        static std::default_random_engine gen(SEED);
         std::normal_distribution<double> dis(mean, stddev);
-        return dis(gen);
+        return dis(randomEngine());
     }
 /**********DISTRIBUTIONS**********/
 
@@ -99,7 +98,7 @@ double uniformDis(double a, double b)
      * @param prio event priority
      * @param created 
      */
-    Event::Event(int proc, int next, int fac, double start, int prio, double created) : processID(proc), processNextState(next), facilityID(fac), startTime(start), priority(prio), timeCreated(created){};
+    Event::Event(int proc, int next, int fac, SimTime start, int prio, SimTime created) : processID(proc), processNextState(next), facilityID(fac), startTime(start), priority(prio), timeCreated(created){};
     /**
      * @brief Default constructor for Event class
      */
@@ -146,6 +145,279 @@ double uniformDis(double a, double b)
 /**********EVENT**********/
 
 
+/**********CALENDAR**********/
+    /**
+     * @brief Construct an empty Calendar
+     */
+    Calendar::Calendar() : freeSlot(-1), seq(0), now(timeKey(0)), laneTime(0), laneCount(0), laneTotal(0)
+    {
+    }
+
+    /**
+     * @brief Map time to an unsigned integer with the same ordering
+     * 
+     * Ticks only need the sign bit flipped, bits of a double are flipped whole for negative values
+     * 
+     * @param time time value
+     * @return integer key, a < b if and only if timeKey(a) < timeKey(b)
+     */
+    uint64_t Calendar::timeKey(SimTime time)
+    {
+#ifdef DISCSIM_TICK_TIME
+        return (uint64_t)time ^ 0x8000000000000000ULL;
+#else
+        uint64_t bits;
+        memcpy(&bits, &time, sizeof(bits));
+        return (bits & 0x8000000000000000ULL) ? ~bits : bits | 0x8000000000000000ULL;
+#endif
+    }
+
+    /**
+     * @brief Inverse of timeKey
+     * 
+     * @param key integer key
+     * @return time value
+     */
+    SimTime Calendar::keyTime(uint64_t key)
+    {
+#ifdef DISCSIM_TICK_TIME
+        return (SimTime)(key ^ 0x8000000000000000ULL);
+#else
+        uint64_t bits = (key & 0x8000000000000000ULL) ? key & ~0x8000000000000000ULL : ~key;
+        double time;
+        memcpy(&time, &bits, sizeof(time));
+        return time;
+#endif
+    }
+
+    /**
+     * @brief Plan an event
+     * 
+     * @param e event to be planned
+     */
+    void Calendar::push(const Event& e)
+    {
+        emplace(e.processID, e.processNextState, e.facilityID, e.startTime, e.priority, e.timeCreated);
+    }
+
+    /**
+     * @brief Plan an event constructed from its attributes
+     * 
+     * @param proc process ID or -1 if custom event
+     * @param next next process state or -1 if custom event
+     * @param fac facility ID or -1 if (not facility process or custom event)
+     * @param start start time
+     * @param prio event priority
+     * @param created time when the event was created
+     */
+    void Calendar::emplace(int proc, int next, int fac, SimTime start, int prio, SimTime created)
+    {
+        uint32_t slot;
+        if (freeSlot < 0)
+        {
+            slot = records.size();
+            records.push_back(Record());
+        }
+        else
+        {
+            slot = freeSlot;
+            freeSlot = records[slot].facilityID;
+        }
+        Record& r = records[slot];
+        r.timeCreated = created;
+        r.processID = proc;
+        r.processNextState = next;
+        r.facilityID = fac;
+
+        if (prio > INT16_MAX)
+            prio = INT16_MAX;
+        else if (prio < INT16_MIN)
+            prio = INT16_MIN;
+        Key k;
+        k.time = timeKey(start);
+        k.order = ((uint64_t)(INT16_MAX - prio) << 48) | (seq++ & 0xFFFFFFFFFFFFULL);
+        k.slot = slot;
+        if (k.time == now && (laneCount == 0 || laneTime == now))
+        {
+            pushLane(k);
+            return;
+        }
+        heap.push_back(k);
+        siftUp(heap.size() - 1, k);
+    }
+
+    /**
+     * @brief Append key to the fast lane bucket of its priority
+     * 
+     * @param k key planned at the current time
+     */
+    void Calendar::pushLane(const Key& k)
+    {
+        uint64_t prio = k.order >> 48;
+        size_t i = 0;
+        while (i < lane.size() && lane[i].prio < prio)
+            i++;
+        if (i == lane.size() || lane[i].prio != prio)
+        {
+            LaneBucket b;
+            b.prio = prio;
+            b.head = 0;
+            lane.insert(lane.begin() + i, b);
+        }
+        lane[i].keys.push_back(k);
+        laneTime = k.time;
+        laneCount++;
+        laneTotal++;
+    }
+
+    /**
+     * @brief Find fast lane bucket holding the first event of the lane
+     * 
+     * @return index of the bucket, -1 if the lane is empty
+     */
+    int Calendar::firstLane() const
+    {
+        if (laneCount == 0)
+            return -1;
+        for (size_t i = 0; i < lane.size(); i++)
+            if (lane[i].head < lane[i].keys.size())
+                return i;
+        return -1;
+    }
+
+    /**
+     * @brief Get the first planned event, calendar must not be empty
+     * 
+     * @return The first planned event
+     */
+    Event Calendar::top() const
+    {
+        int b = firstLane();
+        const Key& k = (b >= 0 && (heap.empty() || before(lane[b].keys[lane[b].head], heap.front()))) ? lane[b].keys[lane[b].head] : heap.front();
+        const Record& r = records[k.slot];
+        return Event(r.processID, r.processNextState, r.facilityID, keyTime(k.time), INT16_MAX - (int)(k.order >> 48), r.timeCreated);
+    }
+
+    /**
+     * @brief Get start time of the first planned event, calendar must not be empty
+     * 
+     * @return The start time of the first planned event
+     */
+    SimTime Calendar::topTime() const
+    {
+        if (laneCount == 0)
+            return keyTime(heap.front().time);
+        if (heap.empty() || laneTime < heap.front().time)
+            return keyTime(laneTime);
+        return keyTime(heap.front().time);
+    }
+
+    /**
+     * @brief Remove the first planned event, calendar must not be empty
+     */
+    void Calendar::pop()
+    {
+        int b = firstLane();
+        uint32_t slot;
+        if (b >= 0 && (heap.empty() || before(lane[b].keys[lane[b].head], heap.front())))
+        {
+            LaneBucket& bucket = lane[b];
+            slot = bucket.keys[bucket.head].slot;
+            now = bucket.keys[bucket.head].time;
+            if (++bucket.head == bucket.keys.size())
+            {
+                bucket.head = 0;
+                bucket.keys.clear();
+            }
+            else if (bucket.head >= 64 && bucket.head * 2 >= bucket.keys.size())
+            {
+                // bucket that never drains (zero delay loops), drop taken keys so it does not grow
+                bucket.keys.erase(bucket.keys.begin(), bucket.keys.begin() + bucket.head);
+                bucket.head = 0;
+            }
+            laneCount--;
+        }
+        else
+        {
+            slot = heap.front().slot;
+            now = heap.front().time;
+            Key last = heap.back();
+            heap.pop_back();
+            if (!heap.empty())
+                siftDown(0, last);
+        }
+        records[slot].facilityID = freeSlot;
+        freeSlot = slot;
+    }
+
+    /**
+     * @brief Remove all planned events, keeps allocated memory
+     */
+    void Calendar::clear()
+    {
+        heap.clear();
+        records.clear();
+        freeSlot = -1;
+        for (size_t i = 0; i < lane.size(); i++)
+        {
+            lane[i].head = 0;
+            lane[i].keys.clear();
+        }
+        laneCount = 0;
+        now = timeKey(0);
+    }
+
+    /**
+     * @brief Reserve memory for n planned events
+     */
+    void Calendar::reserve(size_t n)
+    {
+        heap.reserve(n);
+        records.reserve(n);
+    }
+
+    /**
+     * @brief Move key up from position i to its place in the heap
+     */
+    void Calendar::siftUp(size_t i, Key k)
+    {
+        while (i > 0)
+        {
+            size_t parent = (i - 1) / 4;
+            if (!before(k, heap[parent]))
+                break;
+            heap[i] = heap[parent];
+            i = parent;
+        }
+        heap[i] = k;
+    }
+
+    /**
+     * @brief Move key down from position i to its place in the heap
+     */
+    void Calendar::siftDown(size_t i, Key k)
+    {
+        size_t n = heap.size();
+        while (true)
+        {
+            size_t child = 4 * i + 1;
+            if (child >= n)
+                break;
+            size_t best = child;
+            size_t last = child + 4 < n ? child + 4 : n;
+            for (size_t c = child + 1; c < last; c++)
+                if (before(heap[c], heap[best]))
+                    best = c;
+            if (!before(heap[best], k))
+                break;
+            heap[i] = heap[best];
+            i = best;
+        }
+        heap[i] = k;
+    }
+/**********CALENDAR**********/
+
+
 /**********PROCESS**********/
     /**
      * @brief Construct a new Process:: Process object
@@ -160,9 +432,11 @@ double uniformDis(double a, double b)
             static int IDcntr = 0;
             id = IDcntr;
             IDcntr++;
+            state = st;
             behav = b;
             sim = sm;
-            data = data;
+            this->data = data;
+            buffer = nullptr;
     }
 
     /**
@@ -183,7 +457,19 @@ double uniformDis(double a, double b)
     {
         if (behav) 
         {
-            behav(this, &this->state);
+            // behavior may terminate this process, only locals are used after the call
+            Simulation* s = sim;
+            Instrumentation* instr = s ? s->instr.get() : nullptr;
+            if (instr && instr->sampling)
+            {
+                Instrumentation::Clock::time_point start = Instrumentation::Clock::now();
+                behav(this, &this->state);
+                double elapsed = std::chrono::duration<double, std::nano>(Instrumentation::Clock::now() - start).count();
+                if (s->instr.get() == instr)    // behavior may also disable instrumentation
+                    instr->behavior.add(elapsed);
+            }
+            else
+                behav(this, &this->state);
         }
         else
         {
@@ -216,13 +502,25 @@ double uniformDis(double a, double b)
      * @param a first value for Generating time
      * @param b second value for Generating Ttime
      */
-    Facility::Facility(int id, std::string n, int cap, GenType g, double a, double b) : id(id), name(n), capacity(cap), gen(g), a(a), b(b)
+    Facility::Facility(int id, std::string n, int cap, GenType g, double a, double b) : id(id), name(n), capacity(cap), servers(cap), gen(g), a(a), b(b), dist(g, a, b)
     {
-        stats.processCnt = 0;
-        stats.waitTimeTotal = 0;
-        stats.workTimeTotal = 0;
-        if (gen == GenType::Uniform && a > b)
-            throw std::invalid_argument("Uniform distribution attribute 'a' cannot be less than 'b'");
+        resetStats();
+    }
+
+    /**
+     * @brief Construct a new Facility with any distribution of work time, including table types
+     * 
+     * @param id facility ID
+     * @param n name
+     * @param cap capacity (how many processer can work at the same time)
+     * @param d distribution of work time
+     * @param arena arena of the queue, nullptr to allocate it on the heap
+     */
+    Facility::Facility(int id, std::string n, int cap, const Distribution& d, Arena* arena)
+        : id(id), name(n), capacity(cap), servers(cap), gen(d.type()), a(d.paramA()), b(d.paramB()), dist(d),
+          q(QueueContainer(QueueContainer::allocator_type(arena)))
+    {
+        resetStats();
     }
 
     /**
@@ -257,19 +555,22 @@ double uniformDis(double a, double b)
      */
     double Facility::generateTime()
     {
-        switch(this->gen)
-        {
-            case Facility::GenType::Exp:
-                return expDis(this->a);
-
-            case Facility::GenType::Normal:
-                return normalDis(this->a, this->b);
+        return dist.sample();
+    }
 
-            case Facility::GenType::Uniform:
-            default:
-                return uniformDis(this->a, this->b);
-                break;
-        }
+    /**
+     * @brief generate time value for given GenType and gen values (a,b)
+     * 
+     * Builds the distribution on every call, keep a Distribution when sampling repeatedly
+     * 
+     * @param g type of generating time, not a table type
+     * @param a first value for generating time
+     * @param b second value for generating time
+     * @return The generated time value 
+     */
+    double Facility::generateTime(GenType g, double a, double b)
+    {
+        return Distribution(g, a, b).sample();
     }
     
     /**
@@ -280,15 +581,14 @@ double uniformDis(double a, double b)
      */
     void Facility::activateProcess(Process* proc, int nextState)
     {
+        if (!proc)
+            return;
         double delay = generateTime();
-        double time = proc->sim->getTime();
-        if (proc)
-        {
-            proc->sim->addFacilityEvent(proc->id, nextState, this->id, time + delay, EXIT_FACILITY_PRIO, time); 
-        }
+        SimTime time = proc->sim->getSimTime();
+        proc->sim->calendar.emplace(proc->id, nextState, this->id, addSimTime(time, toSimDelay(delay)), EXIT_FACILITY_PRIO, time);
         
         //update stats
-        this->stats.workTimeTotal += time;
+        this->stats.workTimeTotal += delay;
     };
 
     /**
@@ -311,7 +611,7 @@ double uniformDis(double a, double b)
                 std::cout << "  Proc:" << inQueue.p->id << " start work in Facility: " << this->id<< "\n";
             this->activateProcess(inQueue.p, inQueue.processNextState);
             //update stats
-            this->stats.waitTimeTotal += e.startTime - inQueue.enteredQueueTime;
+            this->stats.waitTimeTotal += fromSimTime(e.startTime - inQueue.enteredQueueTime);
         }
     }
 
@@ -326,21 +626,249 @@ double uniformDis(double a, double b)
         printf("  wait time total: %.3lf\n", stats.waitTimeTotal);
     }
 
+    /**
+     * @brief Reset statistics of the facility, e.g. at the end of a warm-up period
+     */
+    void Facility::resetStats()
+    {
+        stats.processCnt = 0;
+        stats.waitTimeTotal = 0;
+        stats.workTimeTotal = 0;
+    }
+
 /**********FACILITY**********/
 
 
+/**********ARRIVAL SOURCE**********/
+    /**
+     * @brief Construct a new ArrivalSource:: ArrivalSource object
+     * 
+     * @param id source ID
+     * @param g type of generating inter-arrival time
+     * @param a first value for generating time
+     * @param b second value for generating time
+     * @param limit maximal number of generated processes, -1 if unlimited
+     */
+    ArrivalSource::ArrivalSource(int id, Facility::GenType g, double a, double b, int limit) : id(id), gen(g), a(a), b(b), dist(g, a, b), start(0), limit(limit), generated(0)
+    {
+    }
+
+    /**
+     * @brief Construct a new ArrivalSource with any distribution of inter-arrival time
+     * 
+     * @param id source ID
+     * @param d distribution of inter-arrival time
+     * @param limit maximal number of generated processes, -1 if unlimited
+     */
+    ArrivalSource::ArrivalSource(int id, const Distribution& d, int limit) : id(id), gen(d.type()), a(d.paramA()), b(d.paramB()), dist(d), start(0), limit(limit), generated(0)
+    {
+    }
+
+    /**
+     * @brief generate inter-arrival time based on sources GenType and gen values (a,b)
+     * 
+     * @return The generated time value 
+     */
+    double ArrivalSource::generateTime()
+    {
+        return dist.sample();
+    }
+
+    /**
+     * @brief Behavior of the generator process of an ArrivalSource
+     * 
+     * Creates a process walking the sources route and plans its own next activation,
+     * the generator is removed once the source limit is reached.
+     * The generator process data must point to the ArrivalSource
+     * 
+     * @param p generator process
+     * @param data unused
+     */
+    void arrivalSourceBehavior(Process* p, void* data)
+    {
+        ArrivalSource* src = static_cast<ArrivalSource*>(p->data);
+        if (src->limit >= 0 && src->generated >= src->limit)
+        {
+            p->sim->terminateProcess(p->id);
+            return;
+        }
+        src->generated++;
+        p->sim->createProcess(routeBehavior, 0, CREATE_PROCESS_PRIO, src);
+        if (src->limit < 0 || src->generated < src->limit)
+            p->sim->waitFor(p->id, 0, src->generateTime());
+        else
+            p->sim->terminateProcess(p->id);
+    }
+
+    /**
+     * @brief Behavior of a process created by an ArrivalSource
+     * 
+     * State is the index of the next facility in the route. The process is removed
+     * from the simulation once the whole route is visited
+     * 
+     * @param p routed process, its data must point to the ArrivalSource
+     * @param data unused
+     */
+    void routeBehavior(Process* p, void* data)
+    {
+        ArrivalSource* src = static_cast<ArrivalSource*>(p->data);
+        int state = p->state;
+        if (state < (int)src->route.size())
+            p->seize(src->route[state], state + 1);
+        else
+            p->sim->terminateProcess(p->id);
+    }
+/**********ARRIVAL SOURCE**********/
+
 
 /**********SIMULATION**********/
     /**
      * @brief Default constructor for Simulation class
      */
     Simulation::Simulation()
+        : arena(new Arena()),
+          procMap(0, std::hash<int>(), std::equal_to<int>(), ProcessMap::allocator_type(arena.get())),
+          facMap(0, std::hash<int>(), std::equal_to<int>(), FacilityMap::allocator_type(arena.get())),
+          srcMap(0, std::hash<int>(), std::equal_to<int>(), SourceMap::allocator_type(arena.get()))
     {
         time = 0;
         endTime = -1;
+        series = nullptr;
+        seriesInterval = 0;
+        seriesNext = 0;
         // sharedThis = std::shared_ptr<Simulation>(this);
     }
 
+    /**
+     * @brief Clone simulation state: time, calendar, processes, facilities with their queues and sources
+     * 
+     * The clone continues independently of the original. Instrumentation and time series
+     * recording are not copied. Distributions of the clone drop values cached from the original
+     * (the second normal variate), so the clone's draws come only from the shared engine.
+     * Process data pointing to an ArrivalSource of the original is redirected to the clone's
+     * source, any other process data is shared with the original
+     * 
+     * @param other simulation to clone
+     */
+    Simulation::Simulation(const Simulation& other) : Simulation()
+    {
+        copyState(other);
+    }
+
+    /**
+     * @brief Replace state by a clone of another simulation, reuses already allocated memory
+     * 
+     * @param other simulation to clone
+     * @return this simulation
+     */
+    Simulation& Simulation::operator=(const Simulation& other)
+    {
+        if (this != &other)
+            copyState(other);
+        return *this;
+    }
+
+    /**
+     * @brief Copy state of other and redirect pointers into other to this simulation
+     * 
+     * @param other simulation to clone
+     */
+    void Simulation::copyState(const Simulation& other)
+    {
+        time = other.time;
+        endTime = other.endTime;
+        series = nullptr;
+        seriesInterval = 0;
+        seriesNext = 0;
+        instr.reset();
+        calendar = other.calendar;
+        procMap = other.procMap;
+        facMap = other.facMap;
+        srcMap = other.srcMap;
+
+        // sources of other by address, built once so processes are redirected in one pass
+        std::unordered_map<const void*, ArrivalSource*> sources(srcMap.size());
+        for (auto& i : srcMap)
+        {
+            i.second.dist.reset();
+            sources[&other.srcMap.find(i.first)->second] = &i.second;
+        }
+        for (auto& i : procMap)
+        {
+            Process& p = i.second;
+            p.sim = this;
+            auto s = sources.find(p.data);
+            if (s != sources.end())
+                p.data = s->second;
+        }
+        for (auto& i : facMap)
+        {
+            i.second.dist.reset();
+            bindQueue(i.second, &other);
+        }
+    }
+
+    /**
+     * @brief Move facility queue into the simulation arena
+     * 
+     * Copied facilities have their queue on the heap (ArenaAllocator::select_on_container_copy_construction),
+     * the queue is rebuilt in this arena and the heap copy released
+     * 
+     * @param f facility in facMap
+     * @param from simulation the queued processes belong to if it is not this one, they are
+     *             replaced by processes of this simulation with the same ID
+     */
+    void Simulation::bindQueue(Facility& f, const Simulation* from)
+    {
+        Facility::Queue q{Facility::QueueContainer(Facility::QueueContainer::allocator_type(arena.get()))};
+        while (!f.q.empty())
+        {
+            Facility::ProcInQueue w = f.q.front();
+            f.q.pop();
+            if (from)
+                w.p = &procMap.find(w.p->id)->second;
+            q.push(w);
+        }
+        f.q = std::move(q);
+    }
+
+    /**
+     * @brief Remove all processes, facilities, sources and planned events and rewind the clock
+     * 
+     * Reset reuses memory, it is not a faster way to tear down a model. Arena chunks and calendar
+     * vectors are kept, so the next replication allocates almost nothing from the heap. The work
+     * is the same as destroying the Simulation: the maps visit every node and run destructors of
+     * facilities and sources (names, distributions, queues and routes own heap memory), so reset
+     * takes time linear in the number of live objects. Replication throughput is about the same
+     * as with a new Simulation per replication, ahead only for replications of a few events.
+     * Process data created by newPayload is invalid after reset, its destructor is never called.
+     * Instrumentation stays enabled and is reset, time series recording stops
+     */
+    void Simulation::reset()
+    {
+        time = 0;
+        endTime = -1;
+        series = nullptr;
+        seriesInterval = 0;
+        seriesNext = 0;
+        calendar.clear();
+        // replaced by empty maps without buckets, old elements are destroyed, their nodes go back to the arena and are dropped by rewind
+        procMap = ProcessMap(0, std::hash<int>(), std::equal_to<int>(), ProcessMap::allocator_type(arena.get()));
+        facMap = FacilityMap(0, std::hash<int>(), std::equal_to<int>(), FacilityMap::allocator_type(arena.get()));
+        srcMap = SourceMap(0, std::hash<int>(), std::equal_to<int>(), SourceMap::allocator_type(arena.get()));
+        arena->rewind();
+        if (instr)
+            instr->reset();
+    }
+
+    /**
+     * @brief Get memory arena of the simulation
+     */
+    Arena* Simulation::getArena()
+    {
+        return arena.get();
+    }
+
     /**
      * @brief Get the current simulation time
      * 
@@ -348,6 +876,16 @@ double uniformDis(double a, double b)
      */
     double Simulation::getTime()
     // double Simulation::getTime()
+    {
+        return fromSimTime(this->time);
+    }
+
+    /**
+     * @brief Get the current simulation time in the internal representation, ticks with DISCSIM_TICK_TIME
+     * 
+     * @return The current simulation time
+     */
+    SimTime Simulation::getSimTime() const
     {
         return this->time;
     }
@@ -359,7 +897,7 @@ double uniformDis(double a, double b)
      */
     void Simulation::setEndTime(double time)
     {
-        this->endTime = time;
+        this->endTime = toSimTime(time);
     }
 
     /**
@@ -374,7 +912,7 @@ double uniformDis(double a, double b)
      */
     void Simulation::addEvent(int processID, int processNextState, int facilityID, double startTime, int priority, double timeCreated)
     {
-        calendar.emplace(processID, processNextState, facilityID, startTime, priority, timeCreated);
+        calendar.emplace(processID, processNextState, facilityID, toSimTime(startTime), priority, toSimTime(timeCreated));
     }
 
     /**
@@ -398,7 +936,7 @@ double uniformDis(double a, double b)
      */
     void Simulation::addProcessEvent(int processID, int processNextState, double startTime, int priority, double timeCreated)
     {
-        Event e = Event(processID, processNextState, IgnoreID, startTime, priority, this->time);
+        Event e = Event(processID, processNextState, IgnoreID, toSimTime(startTime), priority, this->time);
         calendar.push(e);
     }
 
@@ -414,7 +952,7 @@ double uniformDis(double a, double b)
      */
     void Simulation::addFacilityEvent(int processID, int processNextState, int facilityID, double startTime, int priority, double timeCreated)
     {
-        Event e = Event(processID, processNextState, facilityID, startTime, priority, timeCreated);
+        Event e = Event(processID, processNextState, facilityID, toSimTime(startTime), priority, toSimTime(timeCreated));
         calendar.push(e);
     }
 
@@ -425,20 +963,39 @@ double uniformDis(double a, double b)
      */
     Event Simulation::nextEvent()
     {
+        if (instr)
+        {
+            instr->calendarSize = calendar.size();
+            if (instr->calendarSize > instr->peakCalendar)
+                instr->peakCalendar = instr->calendarSize;
+        }
         Event e = calendar.top();
         calendar.pop();
+        while (series && seriesNext <= e.startTime)
+        {
+            sampleFacilities(seriesNext);
+            seriesNext = addSimTime(seriesNext, seriesInterval);
+        }
         this->time = e.startTime;
+        if (instr && instr->dumpInterval > 0 && getTime() >= instr->nextDump)
+        {
+            instr->print(*instr->dumpStream, getTime());
+            while (instr->nextDump <= getTime())
+                instr->nextDump += instr->dumpInterval;
+        }
         return e;
     }
 
     /**
      * @brief Check if the simulation has finished.
      * 
+     * Simulation is finished when there are no planned events or the next event is after the end time.
+     * 
      * @return true if the simulation has finished, false otherwise.
      */
     bool Simulation::finished()
     {
-        return calendar.empty() || (this->endTime > 0 && this->time > this->endTime);
+        return calendar.empty() || (this->endTime > 0 && calendar.topTime() > this->endTime);
     }
 
     /**
@@ -451,7 +1008,7 @@ double uniformDis(double a, double b)
      */
     void Simulation::createProcess(void (*behav)(Process*, void*), int state, int prio, void* data) 
     {
-        Process p = Process(state, behav, this, nullptr); 
+        Process p = Process(state, behav, this, data); 
         procMap.emplace(p.id, p);
         calendar.emplace(p.id, state, IgnoreID, this->time, prio, this->time); 
     }
@@ -459,7 +1016,7 @@ double uniformDis(double a, double b)
     /**
      * @brief create a process and sets it's activation time to (current Simulation time + delay)
      * 
-     * @param delay
+     * @param delay delay of the activation, NaN or negative throws std::invalid_argument
      * @param behav process behavior function
      * @param state process initial state
      * @param prio activation event priority
@@ -467,9 +1024,9 @@ double uniformDis(double a, double b)
      */
     void Simulation::createProcessDelayed(double delay, void (*behav)(Process *, void *), int state, int prio, void *data)
     {
-        Process p = Process(state, behav, this, nullptr); 
+        Process p = Process(state, behav, this, data); 
         procMap.emplace(p.id, p);
-        calendar.emplace(p.id, state, IgnoreID, this->time + delay, prio, this->time); 
+        calendar.emplace(p.id, state, IgnoreID, addSimTime(this->time, toSimDelay(delay)), prio, this->time); 
     }
 
     /**
@@ -485,11 +1042,12 @@ double uniformDis(double a, double b)
      */
     bool Simulation::createProcessAtTime(double time, void (*behav)(Process *, void *), int state, int prio, void *data)
     {
-        if (this->time > time)
+        SimTime start = toSimTime(time);
+        if (this->time > start)
             return false;            
-        Process p = Process(state, behav, this, nullptr); 
+        Process p = Process(state, behav, this, data); 
         procMap.emplace(p.id, p);
-        calendar.emplace(p.id, state, IgnoreID, time, prio, this->time); 
+        calendar.emplace(p.id, state, IgnoreID, start, prio, this->time); 
         return true;
     }
 
@@ -500,10 +1058,37 @@ double uniformDis(double a, double b)
      * @return Pointer to the executed event
      */
     Event* Simulation::executeEvent(Event e)
+    {
+        if (!instr)
+            return dispatchEvent(e);
+
+        if (e.isProcessEvent())
+            instr->processEvents++;
+        else if (e.isFacilityEvent())
+            instr->facilityEvents++;
+        else
+            instr->customEvents++;
+        if (!instr->startDispatch())
+            return dispatchEvent(e);
+
+        Instrumentation::Clock::time_point start = Instrumentation::Clock::now();
+        Event* res = dispatchEvent(e);
+        instr->dispatch.add(std::chrono::duration<double, std::nano>(Instrumentation::Clock::now() - start).count());
+        instr->sampling = false;
+        return res;
+    }
+
+    /**
+     * @brief Dispatch an event to its process or facility
+     * 
+     * @param e The event to be executed
+     * @return Pointer to the executed event if it is a custom event, nullptr otherwise
+     */
+    Event* Simulation::dispatchEvent(Event e)
     {
         if (e.isProcessEvent())
         {
-            std::unordered_map<int, Process>::iterator i = procMap.find(e.processID);
+            ProcessMap::iterator i = procMap.find(e.processID);
             if (i == procMap.end())
             {
                 std::cerr << " Could not find process: " << e.processID << "  in execute\n";
@@ -521,8 +1106,8 @@ double uniformDis(double a, double b)
         }
         else if (e.isFacilityEvent())
         {
-            std::unordered_map<int, Facility>::iterator fi = facMap.find(e.facilityID);
-            std::unordered_map<int, Process>::iterator pi = procMap.find(e.processID);
+            FacilityMap::iterator fi = facMap.find(e.facilityID);
+            ProcessMap::iterator pi = procMap.find(e.processID);
             if (fi == facMap.end())
             {
                 std::cerr << " Could not find Facility: " << e.processID << "  in execute\n";
@@ -544,6 +1129,19 @@ double uniformDis(double a, double b)
         return new Event(e); // TODo check
     }
 
+    /**
+     * @brief Remove a finished process from the simulation
+     * 
+     * Process must not have any planned events or wait in a facility queue
+     * 
+     * @param processID The ID of the process to be removed
+     */
+    void Simulation::terminateProcess(int processID)
+    {
+        if (procMap.erase(processID) == 0)
+            std::cerr << "Could not find process: " << processID << "  in terminateProcess\n";
+    }
+
     /**
      * @brief Activate a process in the simulation at current sim time
      * 
@@ -553,13 +1151,12 @@ double uniformDis(double a, double b)
      */
     void Simulation::activate(int processID, int state, int prio)
     {
-        std::unordered_map<int, Process>::const_iterator i = procMap.find(processID);
-        auto p = i->second;
-        if (i == procMap.end())
+        if (procMap.find(processID) == procMap.end())
         {
             std::cerr << "Could not find process: " << processID << "  in activate\n";
+            return;
         }
-        calendar.emplace(p.id, state, IgnoreID, this->time, prio, this->time); 
+        calendar.emplace(processID, state, IgnoreID, this->time, prio, this->time); 
     }
 
     /**
@@ -567,18 +1164,17 @@ double uniformDis(double a, double b)
      * 
      * @param processID The ID of the process to wait
      * @param state The state to which the process should transition after waiting
-     * @param delay The time to wait
+     * @param delay The time to wait, NaN or negative throws std::invalid_argument
      * @param prio Priority of the process waiting
      */
     void Simulation::waitFor(int processID, int state, double delay, int prio)
     {        
-        std::unordered_map<int, Process>::const_iterator i = procMap.find(processID);
-        auto p = i->second;
-        if (i == procMap.end())
+        if (procMap.find(processID) == procMap.end())
         {
             std::cerr << "Could not find process: " << processID << "  in waitFor\n";
+            return;
         }
-        calendar.emplace(p.id, state, IgnoreID, this->time + delay, prio, this->time);         
+        calendar.emplace(processID, state, IgnoreID, addSimTime(this->time, toSimDelay(delay)), prio, this->time);         
     }
 
     /**
@@ -591,8 +1187,8 @@ double uniformDis(double a, double b)
      */
     void Simulation::seizeFacility(int processID, int state, int facilityID, int prio)
     {
-        std::unordered_map<int, Facility>::iterator fi = facMap.find(facilityID); // TODO switch to find
-        std::unordered_map<int, Process>::iterator pi = procMap.find(processID);
+        FacilityMap::iterator fi = facMap.find(facilityID); // TODO switch to find
+        ProcessMap::iterator pi = procMap.find(processID);
         if (fi == facMap.end())
         {
             std::cerr << " Could not find Facility: " << facilityID << "  in seizeFacility\n";
@@ -621,6 +1217,8 @@ double uniformDis(double a, double b)
                     std::cout << " queue enter in Facility: " << f->getId() << "\n";
                 Facility::ProcInQueue pq = {p, state, this->time};
                 f->q.push(pq);
+                if (instr)
+                    instr->queueLength(f->id, f->q.size());
             }
             // 
         }
@@ -634,7 +1232,9 @@ double uniformDis(double a, double b)
     void Simulation::createFacility(Facility f)
     {
         // faci.emplace(p.id, state, IgnoreID, this->time, prio, this->time); 
-        this->facMap.emplace(f.getId(), f);
+        std::pair<FacilityMap::iterator, bool> res = this->facMap.emplace(f.getId(), f);
+        if (res.second)
+            bindQueue(res.first->second);
     }
 
     /**
@@ -649,7 +1249,21 @@ double uniformDis(double a, double b)
      */
     void Simulation::createFacility(int id, std::string n, int cap, Facility::GenType g, double a, double b)
     {
-        this->facMap.emplace(id, Facility(id, n, cap, g, a, b));
+        createFacility(id, n, cap, Distribution(g, a, b));
+    }
+
+    /**
+     * @brief Construct a new Facility with any work time distribution and place it into simulation facility map
+     * 
+     * @param id facility ID
+     * @param n name
+     * @param cap capacity (how many processer can work at the same time)
+     * @param d distribution of work time
+     */
+    void Simulation::createFacility(int id, std::string n, int cap, const Distribution& d)
+    {
+        // constructed in place, so the queue is allocated in the arena right away
+        this->facMap.emplace(std::piecewise_construct, std::forward_as_tuple(id), std::forward_as_tuple(id, n, cap, d, arena.get()));
     }
 
     /**
@@ -660,7 +1274,7 @@ double uniformDis(double a, double b)
      */
     Facility *Simulation::findFacility(int id)
     {
-        std::unordered_map<int, Facility>::iterator fi = facMap.find(id); 
+        FacilityMap::iterator fi = facMap.find(id); 
         if (fi == facMap.end())
         {
             std::cerr << " Could not find Facility: " << id << "\n";
@@ -681,6 +1295,151 @@ double uniformDis(double a, double b)
         }
     }
 
+    /**
+     * @brief Create an arrival source and plan its first arrival
+     * 
+     * @param id source ID
+     * @param g type of generating inter-arrival time
+     * @param a first value for generating time
+     * @param b second value for generating time
+     * @param start time of the first arrival
+     * @param limit maximal number of generated processes, -1 if unlimited
+     * @return true if sucessfuly created
+     * @return false if source with the same ID exists or start < Simulation.time
+     */
+    bool Simulation::createArrivalSource(int id, Facility::GenType g, double a, double b, double start, int limit)
+    {
+        return createArrivalSource(id, Distribution(g, a, b), start, limit);
+    }
+
+    /**
+     * @brief Create an arrival source with any inter-arrival time distribution and plan its first arrival
+     * 
+     * @param id source ID
+     * @param d distribution of inter-arrival time
+     * @param start time of the first arrival
+     * @param limit maximal number of generated processes, -1 if unlimited, a source with limit 0 plans no arrival
+     * @return true if sucessfuly created
+     * @return false if source with the same ID exists or start < Simulation.time
+     */
+    bool Simulation::createArrivalSource(int id, const Distribution& d, double start, int limit)
+    {
+        if (this->time > toSimTime(start))
+            return false;
+        std::pair<SourceMap::iterator, bool> res = srcMap.emplace(id, ArrivalSource(id, d, limit));
+        if (!res.second)
+            return false;
+        res.first->second.start = start;
+        if (limit == 0)
+            return true;
+        return createProcessAtTime(start, arrivalSourceBehavior, 0, CREATE_PROCESS_PRIO, &res.first->second);
+    }
+
+    /**
+     * @brief Find an arrival source by its ID in the simulation
+     * 
+     * @param id The ID of the source to find
+     * @return Pointer to the source if found, nullptr otherwise
+     */
+    ArrivalSource *Simulation::findArrivalSource(int id)
+    {
+        SourceMap::iterator si = srcMap.find(id); 
+        if (si == srcMap.end())
+        {
+            std::cerr << " Could not find ArrivalSource: " << id << "\n";
+            return nullptr;
+        }
+        return &si->second;
+    }
+
+    /**
+     * @brief Enable engine instrumentation, keeps already collected statistics if enabled
+     * 
+     * @param sampleEvery every n-th event dispatch and its behavior call is timed, 0 disables timing
+     * @return Pointer to the instrumentation
+     */
+    Instrumentation* Simulation::enableInstrumentation(int sampleEvery)
+    {
+        if (!instr)
+            instr.reset(new Instrumentation(sampleEvery));
+        instr->sampleEvery = sampleEvery;
+        return instr.get();
+    }
+
+    /**
+     * @brief Disable engine instrumentation and drop collected statistics
+     */
+    void Simulation::disableInstrumentation()
+    {
+        instr.reset();
+    }
+
+    /**
+     * @brief Get engine instrumentation
+     * 
+     * @return Pointer to the instrumentation, nullptr if disabled
+     */
+    Instrumentation* Simulation::getInstrumentation()
+    {
+        return instr.get();
+    }
+
+    /**
+     * @brief Periodically print instrumentation statistics, enables instrumentation if needed
+     * 
+     * @param interval simulated time between dumps, 0 stops dumping
+     * @param os output stream
+     */
+    void Simulation::setStatsDump(double interval, std::ostream& os)
+    {
+        if (!instr)
+            enableInstrumentation();
+        instr->dumpInterval = interval;
+        instr->nextDump = getTime() + interval;
+        instr->dumpStream = &os;
+    }
+
+    /**
+     * @brief Record facility state every interval of simulated time
+     * 
+     * Samples are taken at multiples of interval from the current time and hold the state
+     * just before events planned at the sample time. Writer is owned by the caller and must
+     * outlive the simulation run
+     * 
+     * @param writer time series writer, nullptr stops recording
+     * @param interval simulated time between samples
+     */
+    void Simulation::recordTimeSeries(TimeSeriesWriter* writer, double interval)
+    {
+        if (writer && toSimTime(interval) <= 0)
+            throw std::invalid_argument("Time series interval must be positive");
+        this->series = writer;
+        this->seriesInterval = toSimTime(interval);
+        this->seriesNext = this->time;
+    }
+
+    /**
+     * @brief Pass state of all facilities to the time series writer
+     * 
+     * @param sampleTime simulation time of the sample
+     */
+    void Simulation::sampleFacilities(SimTime sampleTime)
+    {
+        FacilitySample s;
+        s.time = fromSimTime(sampleTime);
+        for (auto& i : facMap)
+        {
+            Facility& f = i.second;
+            s.facilityID = f.id;
+            s.queueLen = f.q.size();
+            s.busy = f.servers - f.capacity;
+            s.processCnt = f.stats.processCnt;
+            s.waitTimeTotal = f.stats.waitTimeTotal;
+            s.workTimeTotal = f.stats.workTimeTotal;
+            series->record(s);
+        }
+    }
+
     // Simulation::~Simulation()
     // {
     //     std::cout << "Deleting sim\n";
@@ -9,13 +9,21 @@
 #ifndef DISCRETE_SIM_HPP
 #define DISCRETE_SIM_HPP
 
+#include <cstdint>
+#include <deque>
 #include <iostream>
 #include <queue>
 #include <memory>
 #include <random>
 #include <string>
 #include <unordered_map>
+#include <vector>
 #include <stdexcept>
+#include "arena.hpp"
+#include "distribution.hpp"
+#include "instrumentation.hpp"
+#include "simTime.hpp"
+#include "timeSeries.hpp"
 
 
 extern const bool Verbose;  ///< External boolean variable controlling verbose output
@@ -49,17 +57,18 @@ extern unsigned int SEED;      ///< Seed for random number
         int processID;          ///< The ID of the process associated with the event
         int processNextState;   ///< The next state of the associated process
         int facilityID;         ///< The ID of the facility associated with the event
-        double startTime;       ///< The start time of the event
+        SimTime startTime;      ///< The start time of the event
         int priority;           ///< The priority of the event. Higher priority is better. (100 is important, 0 is less)
-        double timeCreated;     ///< The time when the event was created
+        SimTime timeCreated;    ///< The time when the event was created
 
-        Event(int proc, int nxt, int fac, double start, int prio, double created);
+        Event(int proc, int nxt, int fac, SimTime start, int prio, SimTime created);
         Event();
 
         /**
          * @brief Overloaded less-than operator for comparing events
          * 
-         * Events are compared based on their start time, priority, and creation time
+         * Events are compared based on their start time, priority, and creation time.
+         * Calendar breaks ties of start time and priority in planning order instead
          * 
          * @param other The event to compare with
          * @return true if this event is scheduled to occur earlier than the other event, false otherwise
@@ -77,6 +86,93 @@ extern unsigned int SEED;      ///< Seed for random number
         bool isFacilityEvent();
     };
 
+    /**
+     * @brief The Calendar class is the next event calendar of the simulation
+     * 
+     * Events are split into a packed sort key and a payload record. The heap (4-ary) holds only
+     * the keys, payload records stay in a pool and are touched once when the event is taken.
+     * Key orders events the same way as Event::operator<, but ties of time and priority are
+     * broken by a monotonically increasing sequence number (FIFO) instead of timeCreated.
+     * Priorities are clamped to the int16_t range.
+     * 
+     * Events planned at the time of the last taken event (zero delay) bypass the heap, they go
+     * to a fast lane of FIFO buckets, one per priority, which is merged with the heap top on take
+     */
+    class Calendar
+    {
+    public:
+        Calendar();
+
+        bool empty() const { return heap.empty() && laneCount == 0; }
+        size_t size() const { return heap.size() + laneCount; }
+        uint64_t fastLaneEvents() const { return laneTotal; }
+
+        void push(const Event& e);
+        void emplace(int proc, int next, int fac, SimTime start, int prio, SimTime created);
+        Event top() const;
+        SimTime topTime() const;
+        void pop();
+        void clear();
+        void reserve(size_t n);
+
+        static uint64_t timeKey(SimTime time);
+        static SimTime keyTime(uint64_t key);
+
+    private:
+        /**
+         * @brief Packed sort key of a planned event
+         */
+        struct Key
+        {
+            uint64_t time;      ///< Start time mapped to an order preserving integer
+            uint64_t order;     ///< Inverted priority in the top 16 bits, sequence number in the low 48 bits
+            uint32_t slot;      ///< Index of the payload record
+        };
+        /**
+         * @brief Payload of a planned event
+         */
+        struct Record
+        {
+            SimTime timeCreated;    ///< The time when the event was created
+            int processID;      ///< The ID of the process associated with the event
+            int processNextState;   ///< The next state of the associated process
+            int facilityID;     ///< The ID of the facility associated with the event, next free record if unused
+        };
+
+        /**
+         * @brief FIFO of fast lane keys with the same priority
+         */
+        struct LaneBucket
+        {
+            uint64_t prio;              ///< Priority bits of Key::order shared by all keys in the bucket
+            size_t head;                ///< Index of the first key in keys
+            std::vector<Key> keys;      ///< Keys in planning order, keys before head are taken
+        };
+
+        std::vector<Key> heap;          ///< 4-ary min-heap of keys
+        std::vector<Record> records;    ///< Pool of payload records
+        int freeSlot;                   ///< First unused record in the pool, -1 if none
+        uint64_t seq;                   ///< Sequence number of the next planned event
+        uint64_t now;                   ///< Time key of the last taken event
+        std::vector<LaneBucket> lane;   ///< Fast lane buckets sorted from the highest priority
+        uint64_t laneTime;              ///< Time key of all events in the fast lane
+        size_t laneCount;               ///< Number of events in the fast lane
+        uint64_t laneTotal;             ///< Number of events ever planned through the fast lane
+
+        int firstLane() const;
+        void pushLane(const Key& k);
+
+        /**
+         * @brief Compare keys, true if a is taken before b
+         */
+        static bool before(const Key& a, const Key& b)
+        {
+            return a.time < b.time || (a.time == b.time && a.order < b.order);
+        }
+        void siftUp(size_t i, Key k);
+        void siftDown(size_t i, Key k);
+    };
+
     /**
      * @brief The Process class represents a discrete process in the simulation
      * 
@@ -107,23 +203,17 @@ extern unsigned int SEED;      ///< Seed for random number
     class Facility
     {
     public:
-        /**
-         * @brief This enum represents the types of distributions used for generating random numbers
-         * 
-         */
-        enum class GenType {
-            Uniform,    ///< Uniform distribution
-            Exp,        ///< Exponential distribution
-            Normal      ///< Normal distribution
-        };
-        
+        typedef ::GenType GenType;  ///< Distribution types, kept here so Facility::GenType::Exp still works
+
         Facility(int id, std::string n, int cap, GenType g , double a , double );
+        Facility(int id, std::string n, int cap, const Distribution& d, Arena* arena = nullptr);
         friend std::ostream& operator<<(std::ostream& os, const Facility& f);
         int getId();
 
         void activateProcess(Process* proc, int nextState);
         void ProcessExit(Process* proc, Event e);
         void printStats();
+        void resetStats();
         
     
         struct FacilityStats    ///< Structure to hold facility statistics
@@ -136,21 +226,56 @@ extern unsigned int SEED;      ///< Seed for random number
         {
             Process* p;             ///< Pointer to the process
             int processNextState;   ///< The next state of the process
-            double enteredQueueTime;    ///< The time when the process entered the queue
+            SimTime enteredQueueTime;   ///< The time when the process entered the queue
         };
 
         int id;             ///< The ID of the facility
         std::string name;   ///< The name of the facility
-        int capacity;       ///< The capacity of the facility
+        int capacity;       ///< The free capacity of the facility (number of idle servers)
+        int servers;        ///< The total capacity of the facility
         GenType gen;        ///< The generation type for facility usage time
-        double a;           ///< The first parameter for generating facility usage time (depends on generation type)
-        double b;           ///< The second parameter for generating facility usage time (depends on generation type)
+        double a;           ///< The first parameter for generating facility usage time (depends on generation type, 0 for table types)
+        double b;           ///< The second parameter for generating facility usage time (depends on generation type, 0 for table types)
+        Distribution dist;  ///< The distribution of facility usage time, generateTime draws from it
         struct FacilityStats stats; ///< The Facility statistics
-        std::queue<ProcInQueue> q;  ///< Queue of processes waiting to enter the facility
+        typedef std::deque<ProcInQueue, ArenaAllocator<ProcInQueue>> QueueContainer;   ///< Storage of the queue, in the Simulation arena
+        typedef std::queue<ProcInQueue, QueueContainer> Queue;                          ///< Queue of waiting processes
+
+        Queue q;            ///< Queue of processes waiting to enter the facility
+
+        double generateTime();
+        static double generateTime(GenType g, double a, double b);
+    };
+
+    /**
+     * @brief The ArrivalSource class represents a generator of processes that walk a route of facilities
+     * 
+     * The source is driven by its own generator process, which creates a new process after each
+     * generated inter-arrival time. Created processes seize the route facilities one after another
+     * and are removed from the simulation after leaving the last one
+     */
+    class ArrivalSource
+    {
+    public:
+        int id;                 ///< The ID of the source
+        Facility::GenType gen;  ///< The generation type for inter-arrival time
+        double a;               ///< The first parameter for generating inter-arrival time
+        double b;               ///< The second parameter for generating inter-arrival time
+        Distribution dist;      ///< The distribution of inter-arrival time, generateTime draws from it
+        double start;           ///< Time of the first arrival
+        int limit;              ///< Maximal number of generated processes, -1 if unlimited
+        int generated;          ///< Number of already generated processes
+        std::vector<int> route; ///< IDs of facilities visited by the generated processes, in order
+
+        ArrivalSource(int id, Facility::GenType g, double a, double b, int limit = -1);
+        ArrivalSource(int id, const Distribution& d, int limit = -1);
 
         double generateTime();
     };
 
+    void arrivalSourceBehavior(Process* p, void* data);
+    void routeBehavior(Process* p, void* data);
+
     /**
      * @brief The Simulation class represents a discrete event simulation
      * 
@@ -158,19 +283,67 @@ extern unsigned int SEED;      ///< Seed for random number
      */
     class Simulation 
     {
+    public:
+        typedef std::unordered_map<int, Process, std::hash<int>, std::equal_to<int>, ArenaAllocator<std::pair<const int, Process>>> ProcessMap;            ///< Processes by ID
+        typedef std::unordered_map<int, Facility, std::hash<int>, std::equal_to<int>, ArenaAllocator<std::pair<const int, Facility>>> FacilityMap;        ///< Facilities by ID
+        typedef std::unordered_map<int, ArrivalSource, std::hash<int>, std::equal_to<int>, ArenaAllocator<std::pair<const int, ArrivalSource>>> SourceMap; ///< Arrival sources by ID
+
     private:
-        double time;    ///< Current simulation time
-        double endTime; ///< End time of the simulation, -1 if the simulation should not end on timer
+        SimTime time;       ///< Current simulation time
+        SimTime endTime;    ///< End time of the simulation, negative if the simulation should not end on timer
+        std::unique_ptr<Arena> arena;   ///< Memory of processes, facilities, sources and facility queues
+
+        TimeSeriesWriter* series;   ///< Writer of facility time series, nullptr if not recorded
+        SimTime seriesInterval;     ///< Simulated time between time series samples
+        SimTime seriesNext;         ///< Simulated time of the next time series sample
+
+        Event* dispatchEvent(Event e);
+        void sampleFacilities(SimTime sampleTime);
+        void copyState(const Simulation& other);
+        void bindQueue(Facility& f, const Simulation* from = nullptr);
     public:
-        std::priority_queue<Event> calendar;        ///< Priority queue for storing simulation events
-        std::unordered_map<int, Process> procMap;   ///< Map of processes in the simulation
-        std::unordered_map<int, Facility> facMap;   ///< Map of facilities in the simulation
+        Calendar calendar;      ///< Calendar of planned simulation events
+        ProcessMap procMap;     ///< Map of processes in the simulation
+        FacilityMap facMap;     ///< Map of facilities in the simulation
+        SourceMap srcMap;       ///< Map of arrival sources in the simulation
+        std::unique_ptr<Instrumentation> instr;     ///< Engine instrumentation, null if disabled
 
 
         Simulation();
+        Simulation(const Simulation& other);
+        Simulation& operator=(const Simulation& other);
+        void reset();
+        Arena* getArena();
+
+        /**
+         * @brief Construct process data in the simulation arena
+         * 
+         * Memory is reclaimed by deletePayload or all at once by reset, the destructor is never called
+         * 
+         * @param args constructor arguments
+         * @return pointer to the constructed object
+         */
+        template <typename T, typename... Args>
+        T* newPayload(Args&&... args)
+        {
+            static_assert(std::is_trivially_destructible<T>::value, "Payload must be trivially destructible, reset does not call destructors");
+            return new (arena->allocate(sizeof(T))) T(std::forward<Args>(args)...);
+        }
+
+        /**
+         * @brief Return memory of process data created by newPayload to the arena
+         * 
+         * @param p pointer returned by newPayload
+         */
+        template <typename T>
+        void deletePayload(T* p)
+        {
+            arena->deallocate(p, sizeof(T));
+        }
 
         
         double getTime ();
+        SimTime getSimTime() const;
         void setEndTime(double time);
 
         void addEvent(int processID, int processNextState, int facilityID, double startTime, int priority, double timeCreated);
@@ -184,6 +357,7 @@ extern unsigned int SEED;      ///< Seed for random number
         void createProcessDelayed(double delay, void (*behav)(Process*, void*), int state = 0, int prio = CREATE_PROCESS_PRIO, void* data = nullptr);
         bool createProcessAtTime(double time, void (*behav)(Process*, void*), int state = 0, int prio = CREATE_PROCESS_PRIO, void* data = nullptr);;
         Event* executeEvent(Event e);
+        void terminateProcess(int processID);
 
         void activate(int processID, int state,  int prio = ACTIVATE_PROCESS_PRIO);
         void waitFor(int processID, int state, double delay,  int prio = ACTIVATE_PROCESS_PRIO);
@@ -192,9 +366,19 @@ extern unsigned int SEED;      ///< Seed for random number
 
         void createFacility(Facility f);
         void createFacility(int id, std::string n, int cap, Facility::GenType g, double a, double b);
+        void createFacility(int id, std::string n, int cap, const Distribution& d);
         Facility* findFacility(int id);
         void printFacilitysStats();
-        
+
+        bool createArrivalSource(int id, Facility::GenType g, double a, double b, double start = 0, int limit = -1);
+        bool createArrivalSource(int id, const Distribution& d, double start = 0, int limit = -1);
+        ArrivalSource* findArrivalSource(int id);
+
+        Instrumentation* enableInstrumentation(int sampleEvery = 64);
+        void disableInstrumentation();
+        Instrumentation* getInstrumentation();
+        void setStatsDump(double interval, std::ostream& os = std::cout);
+        void recordTimeSeries(TimeSeriesWriter* writer, double interval);
     };
 
 
@@ -0,0 +1,425 @@
+/**
+ * @file distribution.cpp
+ * @author Adam Hos <xhosad00>
+ * @brief Time distributions of facilities and arrival sources with constant time sampling
+ */
+
+#include "discreteSim.hpp"
+
+#include <cmath>
+
+/**********DISTRIBUTION**********/
+    /**
+     * @brief Random engine shared by all distributions and the *Dis functions
+     *
+     * Created on first use, so a seed set by parseArguments before the simulation starts is used
+     */
+    std::default_random_engine& randomEngine()
+    {
+        static std::default_random_engine gen(SEED);
+        return gen;
+    }
+
+    /**
+     * @brief Construct a distribution always returning 0
+     */
+    Distribution::Distribution() : gen(GenType::Deterministic), a(0), b(0)
+    {
+    }
+
+    /**
+     * @brief Construct a two-parameter distribution
+     *
+     * @param g type of the distribution, not a table type
+     * @param a first parameter, see GenType
+     * @param b second parameter, see GenType
+     */
+    Distribution::Distribution(GenType g, double a, double b) : gen(g), a(a), b(b)
+    {
+        switch (g)
+        {
+            case GenType::Uniform:
+                if (a > b)
+                    throw std::invalid_argument("Uniform distribution attribute 'a' cannot be less than 'b'");
+                break;
+
+            case GenType::Exp:
+                if (!(a > 0))
+                    throw std::invalid_argument("Exponential distribution rate must be positive");
+                exponential = std::exponential_distribution<double>(a);
+                break;
+
+            case GenType::Normal:
+            case GenType::LogNormal:
+                if (b < 0)
+                    throw std::invalid_argument("Normal distribution standard deviation cannot be negative");
+                normal = std::normal_distribution<double>(a, b);
+                break;
+
+            case GenType::Erlang:
+                if (!(a >= 1) || a != std::floor(a) || !(b > 0))
+                    throw std::invalid_argument("Erlang distribution needs a positive integer number of phases and a positive rate");
+                gamma = std::gamma_distribution<double>(a, 1.0 / b);
+                break;
+
+            case GenType::Deterministic:
+                break;
+
+            default:
+                throw std::invalid_argument("Table distributions are created by Distribution::empirical, discrete, hyperExp or phaseType");
+        }
+    }
+
+    /**
+     * @brief Create histogram distribution, value is uniform inside a bin chosen with its weight
+     *
+     * @param edges non-decreasing bin edges, one more than weights
+     * @param weights non-negative bin weights, not all zero
+     */
+    Distribution Distribution::empirical(const std::vector<double>& edges, const std::vector<double>& weights)
+    {
+        if (edges.size() != weights.size() + 1)
+            throw std::invalid_argument("Empirical distribution needs one more bin edge than weights");
+        Distribution d;
+        d.gen = GenType::Empirical;
+        d.buildAlias(weights);
+        for (size_t i = 0; i < weights.size(); i++)
+        {
+            if (edges[i + 1] < edges[i])
+                throw std::invalid_argument("Empirical distribution bin edges must not decrease");
+            d.value.push_back(edges[i]);
+            d.span.push_back(edges[i + 1] - edges[i]);
+        }
+        return d;
+    }
+
+    /**
+     * @brief Create discrete distribution returning a value from the table chosen with its weight
+     *
+     * @param values returned values
+     * @param weights non-negative weights of the values, not all zero
+     */
+    Distribution Distribution::discrete(const std::vector<double>& values, const std::vector<double>& weights)
+    {
+        if (values.size() != weights.size())
+            throw std::invalid_argument("Discrete distribution needs a weight for every value");
+        Distribution d;
+        d.gen = GenType::Discrete;
+        d.buildAlias(weights);
+        d.value = values;
+        return d;
+    }
+
+    /**
+     * @brief Create hyperexponential distribution
+     *
+     * @param probs probabilities (weights) of the branches
+     * @param rates positive rate of every branch
+     */
+    Distribution Distribution::hyperExp(const std::vector<double>& probs, const std::vector<double>& rates)
+    {
+        if (probs.size() != rates.size())
+            throw std::invalid_argument("Hyperexponential distribution needs a rate for every branch");
+        Distribution d;
+        d.gen = GenType::HyperExp;
+        d.buildAlias(probs);
+        for (double r : rates)
+            if (!(r > 0))
+                throw std::invalid_argument("Hyperexponential distribution rates must be positive");
+        d.value = rates;
+        d.exponential = std::exponential_distribution<double>(1.0);
+        return d;
+    }
+
+    /**
+     * @brief Create phase-type distribution as a mixture of Erlang branches
+     *
+     * @param probs probabilities (weights) of the branches
+     * @param phases positive number of phases of every branch
+     * @param rates positive rate of one phase of every branch
+     */
+    Distribution Distribution::phaseType(const std::vector<double>& probs, const std::vector<int>& phases, const std::vector<double>& rates)
+    {
+        if (probs.size() != rates.size() || probs.size() != phases.size())
+            throw std::invalid_argument("Phase-type distribution needs phases and a rate for every branch");
+        Distribution d;
+        d.gen = GenType::PhaseType;
+        d.buildAlias(probs);
+        for (size_t i = 0; i < probs.size(); i++)
+        {
+            if (phases[i] < 1 || !(rates[i] > 0))
+                throw std::invalid_argument("Phase-type distribution needs positive phases and rates");
+            d.branch.push_back(std::gamma_distribution<double>(phases[i], 1.0 / rates[i]));
+        }
+        d.value = rates;
+        return d;
+    }
+
+    /**
+     * @brief Build alias table of the weights (Vose's method)
+     *
+     * @param weights non-negative weights, not all zero
+     */
+    void Distribution::buildAlias(const std::vector<double>& weights)
+    {
+        double sum = 0;
+        for (double w : weights)
+        {
+            if (!(w >= 0))
+                throw std::invalid_argument("Distribution weights cannot be negative");
+            sum += w;
+        }
+        if (weights.empty() || !(sum > 0))
+            throw std::invalid_argument("Distribution needs at least one positive weight");
+
+        size_t n = weights.size();
+        weight.resize(n);
+        aliasProb.resize(n);
+        alias.resize(n);
+        std::vector<double> scaled(n);
+        std::vector<uint32_t> small, large;
+        for (size_t i = 0; i < n; i++)
+        {
+            weight[i] = weights[i] / sum;
+            scaled[i] = weight[i] * n;
+            (scaled[i] < 1 ? small : large).push_back(i);
+        }
+        while (!small.empty() && !large.empty())
+        {
+            uint32_t s = small.back();
+            small.pop_back();
+            uint32_t l = large.back();
+            aliasProb[s] = scaled[s];
+            alias[s] = l;
+            scaled[l] += scaled[s] - 1;
+            if (scaled[l] < 1)
+            {
+                large.pop_back();
+                small.push_back(l);
+            }
+        }
+        // rest has probability 1 up to rounding
+        for (uint32_t i : large)
+        {
+            aliasProb[i] = 1;
+            alias[i] = i;
+        }
+        for (uint32_t i : small)
+        {
+            aliasProb[i] = 1;
+            alias[i] = i;
+        }
+    }
+
+    /**
+     * @brief Choose entry of the alias table with one uniform variate
+     */
+    uint32_t Distribution::pick()
+    {
+        double u = unit(randomEngine()) * aliasProb.size();
+        uint32_t i = (uint32_t)u;
+        if (i >= aliasProb.size())
+            i = aliasProb.size() - 1;
+        return u - i < aliasProb[i] ? i : alias[i];
+    }
+
+    /**
+     * @brief Drop state cached between samples
+     *
+     * std::normal_distribution keeps the second variate of a pair (also inside the gamma
+     * distributions), a copy would return the same value as the original
+     */
+    void Distribution::reset()
+    {
+        unit.reset();
+        exponential.reset();
+        normal.reset();
+        gamma.reset();
+        for (std::gamma_distribution<double>& g : branch)
+            g.reset();
+    }
+
+    /**
+     * @brief Get type of the distribution
+     */
+    GenType Distribution::type() const
+    {
+        return gen;
+    }
+
+    /**
+     * @brief Get first parameter of a two-parameter distribution, 0 for table types
+     */
+    double Distribution::paramA() const
+    {
+        return a;
+    }
+
+    /**
+     * @brief Get second parameter of a two-parameter distribution, 0 for table types
+     */
+    double Distribution::paramB() const
+    {
+        return b;
+    }
+
+    /**
+     * @brief Compute first and second moment of the distribution
+     *
+     * @param m1 mean
+     * @param m2 mean of the square
+     */
+    void Distribution::moments(double& m1, double& m2) const
+    {
+        m1 = m2 = 0;
+        switch (gen)
+        {
+            case GenType::Uniform:
+                m1 = (a + b) / 2;
+                m2 = (a * a + a * b + b * b) / 3;
+                break;
+
+            case GenType::Exp:
+                m1 = 1 / a;
+                m2 = 2 / (a * a);
+                break;
+
+            case GenType::Normal:
+            {
+                if (b == 0)
+                {
+                    m1 = a > 0 ? a : 0;
+                    m2 = m1 * m1;
+                    break;
+                }
+                // normal clamped at 0
+                double z = a / b;
+                double cdf = 0.5 * std::erfc(-z / std::sqrt(2.0));
+                double pdf = std::exp(-z * z / 2) / 2.5066282746310002;   // sqrt(2 pi)
+                m1 = a * cdf + b * pdf;
+                m2 = (a * a + b * b) * cdf + a * b * pdf;
+                break;
+            }
+
+            case GenType::Deterministic:
+                m1 = a;
+                m2 = a * a;
+                break;
+
+            case GenType::Erlang:
+                m1 = a / b;
+                m2 = a * (a + 1) / (b * b);
+                break;
+
+            case GenType::LogNormal:
+                m1 = std::exp(a + b * b / 2);
+                m2 = std::exp(2 * a + 2 * b * b);
+                break;
+
+            case GenType::Empirical:
+                for (size_t i = 0; i < weight.size(); i++)
+                {
+                    m1 += weight[i] * (value[i] + span[i] / 2);
+                    m2 += weight[i] * (value[i] * value[i] + value[i] * span[i] + span[i] * span[i] / 3);
+                }
+                break;
+
+            case GenType::Discrete:
+                for (size_t i = 0; i < weight.size(); i++)
+                {
+                    m1 += weight[i] * value[i];
+                    m2 += weight[i] * value[i] * value[i];
+                }
+                break;
+
+            case GenType::HyperExp:
+                for (size_t i = 0; i < weight.size(); i++)
+                {
+                    m1 += weight[i] / value[i];
+                    m2 += 2 * weight[i] / (value[i] * value[i]);
+                }
+                break;
+
+            case GenType::PhaseType:
+                for (size_t i = 0; i < weight.size(); i++)
+                {
+                    double k = branch[i].alpha();
+                    m1 += weight[i] * k / value[i];
+                    m2 += weight[i] * k * (k + 1) / (value[i] * value[i]);
+                }
+                break;
+        }
+    }
+
+    /**
+     * @brief Analytic mean of the distribution
+     */
+    double Distribution::mean() const
+    {
+        double m1, m2;
+        moments(m1, m2);
+        return m1;
+    }
+
+    /**
+     * @brief Analytic variance of the distribution
+     */
+    double Distribution::variance() const
+    {
+        double m1, m2;
+        moments(m1, m2);
+        return m2 - m1 * m1;
+    }
+
+    /**
+     * @brief Draw one value, constant time for every type
+     *
+     * @return The generated value
+     */
+    double Distribution::sample()
+    {
+        std::default_random_engine& eng = randomEngine();
+        switch (gen)
+        {
+            case GenType::Exp:
+                return exponential(eng);
+
+            case GenType::Normal:
+            {
+                double x = normal(eng);
+                return x > 0 ? x : 0;
+            }
+
+            case GenType::Deterministic:
+                return a;
+
+            case GenType::Erlang:
+                return gamma(eng);
+
+            case GenType::LogNormal:
+                return std::exp(normal(eng));
+
+            case GenType::Empirical:
+            {
+                uint32_t i = pick();
+                return value[i] + span[i] * unit(eng);
+            }
+
+            case GenType::Discrete:
+                return value[pick()];
+
+            case GenType::HyperExp:
+            {
+                uint32_t i = pick();
+                return exponential(eng) / value[i];
+            }
+
+            case GenType::PhaseType:
+                return branch[pick()](eng);
+
+            case GenType::Uniform:
+            default:
+                return a + (b - a) * unit(eng);
+        }
+    }
+/**********DISTRIBUTION**********/
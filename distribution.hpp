@@ -0,0 +1,85 @@
+/**
+ * @file distribution.hpp
+ * @author Adam Hos <xhosad00>
+ * @brief Time distributions of facilities and arrival sources with constant time sampling
+ *
+ * Parameters are checked and precomputed when the distribution is created, discrete choices
+ * (empirical bins, mixture branches) are drawn with the alias method, so sample() takes the
+ * same time for any table size. All distributions draw from one engine seeded with SEED
+ */
+
+#ifndef DISTRIBUTION_HPP
+#define DISTRIBUTION_HPP
+
+#include <cstdint>
+#include <random>
+#include <vector>
+
+    /**
+     * @brief This enum represents the types of distributions used for generating random numbers
+     *
+     * Meaning of parameters a, b of the two-parameter types is given for each value
+     */
+    enum class GenType {
+        Uniform,        ///< Uniform distribution on [a, b)
+        Exp,            ///< Exponential distribution with rate a
+        Normal,         ///< Normal distribution with mean a and standard deviation b, negative values are clamped to 0
+        Deterministic,  ///< Constant value a
+        Erlang,         ///< Sum of a exponential phases with rate b each
+        LogNormal,      ///< exp(N), N normal with mean a and standard deviation b
+        Empirical,      ///< Histogram, uniform inside a bin chosen with bin weight
+        Discrete,       ///< Value from a table chosen with its weight
+        HyperExp,       ///< Mixture of exponential distributions
+        PhaseType       ///< Mixture of Erlang distributions
+    };
+
+    std::default_random_engine& randomEngine();
+
+    /**
+     * @brief The Distribution class generates random times of one distribution
+     *
+     * Two-parameter types are created by the constructor, table types by the static factories
+     */
+    class Distribution
+    {
+    public:
+        Distribution();
+        Distribution(GenType g, double a, double b);
+
+        static Distribution empirical(const std::vector<double>& edges, const std::vector<double>& weights);
+        static Distribution discrete(const std::vector<double>& values, const std::vector<double>& weights);
+        static Distribution hyperExp(const std::vector<double>& probs, const std::vector<double>& rates);
+        static Distribution phaseType(const std::vector<double>& probs, const std::vector<int>& phases, const std::vector<double>& rates);
+
+        GenType type() const;
+        double paramA() const;
+        double paramB() const;
+        double mean() const;
+        double variance() const;
+
+        double sample();
+        void reset();
+
+    private:
+        GenType gen;        ///< Type of the distribution
+        double a;           ///< First parameter of two-parameter types
+        double b;           ///< Second parameter of two-parameter types
+
+        std::vector<double> aliasProb;      ///< Probability of keeping entry i in the alias table
+        std::vector<uint32_t> alias;        ///< Alias of entry i
+        std::vector<double> weight;         ///< Normalized weight of entry i
+        std::vector<double> value;          ///< Bin start, discrete value or branch rate of entry i
+        std::vector<double> span;           ///< Bin width of entry i (Empirical only)
+        std::vector<std::gamma_distribution<double>> branch;    ///< Erlang branches (PhaseType only)
+
+        std::uniform_real_distribution<double> unit;        ///< Uniform on [0, 1)
+        std::exponential_distribution<double> exponential;  ///< Exp, HyperExp with rate 1
+        std::normal_distribution<double> normal;            ///< Normal and LogNormal
+        std::gamma_distribution<double> gamma;              ///< Erlang
+
+        void buildAlias(const std::vector<double>& weights);
+        uint32_t pick();
+        void moments(double& m1, double& m2) const;
+    };
+
+#endif // DISTRIBUTION_HPP
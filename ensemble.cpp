@@ -0,0 +1,470 @@
+/**
+ * @file ensemble.cpp
+ * @author Adam Hos <xhosad00>
+ * @brief Lockstep ensemble of replications of a simple queueing network
+ */
+
+#include "ensemble.hpp"
+
+#include <cmath>
+#include <cstring>
+
+    /**
+     * @brief Natural logarithm of a positive normal number without a libm call, so lane loops vectorize
+     *
+     * x = 2^k * m with m in [sqrt(1/2), sqrt(2)), log(m) = 2 atanh(t) with t = (m - 1) / (m + 1)
+     * is summed up to t^23, relative error is below 1e-15
+     */
+    static inline double laneLog(double x)
+    {
+        uint64_t ix;
+        memcpy(&ix, &x, sizeof(ix));
+        ix -= 0x3FE6A09E667F3BCDULL;
+        int64_t k = (int64_t)ix >> 52;
+        uint64_t mb = (ix & 0x000FFFFFFFFFFFFFULL) + 0x3FE6A09E667F3BCDULL;
+        double m;
+        memcpy(&m, &mb, sizeof(m));
+        // small integer to double through the mantissa, int64 conversion does not vectorize before AVX-512
+        uint64_t kb = 0x4330000000000000ULL + (uint64_t)(k + 1024);
+        double kd;
+        memcpy(&kd, &kb, sizeof(kd));
+        kd -= 4503599627370496.0 + 1024;
+        double f = m - 1.0;
+        double t = f / (2.0 + f);
+        double z = t * t;
+        double p = 1.0 / 23;
+        p = p * z + 1.0 / 21;
+        p = p * z + 1.0 / 19;
+        p = p * z + 1.0 / 17;
+        p = p * z + 1.0 / 15;
+        p = p * z + 1.0 / 13;
+        p = p * z + 1.0 / 11;
+        p = p * z + 1.0 / 9;
+        p = p * z + 1.0 / 7;
+        p = p * z + 1.0 / 5;
+        p = p * z + 1.0 / 3;
+        p = p * z + 1.0;
+        return kd * 0.6931471805599453 + 2.0 * t * p;
+    }
+
+/**********ENSEMBLE**********/
+    /**
+     * @brief Construct an ensemble without arrivals and stages
+     *
+     * @param replications number of replications simulated together
+     * @param seed seed of the random streams, replication r uses a stream derived from seed + r
+     */
+    Ensemble::Ensemble(int replications, unsigned int seed)
+        : reps(replications), arrGen(Facility::GenType::Exp), arrA(1), arrB(0), arrStart(0), arrLimit(-1), rng(replications), scratch(replications), chunk(replications)
+    {
+        if (replications < 1)
+            throw std::invalid_argument("Ensemble needs at least one replication");
+        for (int r = 0; r < reps; r++)
+        {
+            // splitmix64 of the replication index, so neighbouring streams are not correlated
+            uint64_t z = (uint64_t)seed * 0x9E3779B97F4A7C15ULL + (uint64_t)r * 0xD1B54A32D192ED03ULL;
+            z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+            z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+            rng[r] = z ^ (z >> 31);
+        }
+    }
+
+    /**
+     * @brief Set inter-arrival time distribution of the source
+     *
+     * @param g type of generating inter-arrival time
+     * @param a first value for generating time
+     * @param b second value for generating time
+     * @param start time of the first arrival
+     * @param limit maximal number of arrivals of every replication, -1 if unlimited
+     */
+    void Ensemble::setArrivals(Facility::GenType g, double a, double b, double start, int limit)
+    {
+        if (!supported(g))
+            throw std::invalid_argument("Ensemble supports only two-parameter distributions");
+        Distribution(g, a, b);  // throws on invalid parameters
+        arrGen = g;
+        arrA = a;
+        arrB = b;
+        arrStart = start;
+        arrLimit = limit;
+    }
+
+    /**
+     * @brief Append facility to the line
+     *
+     * @param servers capacity of the facility
+     * @param g type of generating service time
+     * @param a first value for generating time
+     * @param b second value for generating time
+     */
+    void Ensemble::addStage(int servers, Facility::GenType g, double a, double b)
+    {
+        if (servers < 1)
+            throw std::invalid_argument("Facility capacity must be positive");
+        if (!line.empty() && line.back().servers > 1)
+            throw std::invalid_argument("Ensemble supports multi-server facilities only as the last stage");
+        if (!supported(g))
+            throw std::invalid_argument("Ensemble supports only two-parameter distributions");
+        Distribution(g, a, b);  // throws on invalid parameters
+        Stage s;
+        s.servers = servers;
+        s.gen = g;
+        s.a = a;
+        s.b = b;
+        line.push_back(s);
+    }
+
+    /**
+     * @brief Check if a distribution can be sampled by the ensemble
+     */
+    bool Ensemble::supported(Facility::GenType g)
+    {
+        return g != Facility::GenType::Empirical && g != Facility::GenType::Discrete
+            && g != Facility::GenType::HyperExp && g != Facility::GenType::PhaseType;
+    }
+
+    /**
+     * @brief Copy arrival source, including its start and limit, and its route facilities from a simulation
+     *
+     * The ensemble is not changed if the network cannot be loaded
+     *
+     * @param sim simulation holding the network, e.g. loaded by loadModel
+     * @param sourceID ID of the arrival source
+     * @return false if the source or a route facility does not exist, a distribution is a table
+     *         type or a multi-server facility is not the last one
+     */
+    bool Ensemble::loadRoute(Simulation* sim, int sourceID)
+    {
+        ArrivalSource* src = sim->findArrivalSource(sourceID);
+        if (!src)
+            return false;
+        if (!supported(src->gen))
+        {
+            std::cerr << "Ensemble: table distribution of ArrivalSource " << sourceID << " is not supported\n";
+            return false;
+        }
+        std::vector<Facility*> route;
+        for (size_t i = 0; i < src->route.size(); i++)
+        {
+            Facility* f = sim->findFacility(src->route[i]);
+            if (!f)
+                return false;
+            if (!supported(f->gen))
+            {
+                std::cerr << "Ensemble: table distribution of Facility " << f->id << " is not supported\n";
+                return false;
+            }
+            if (f->servers > 1 && i + 1 < src->route.size())
+            {
+                std::cerr << "Ensemble: multi-server Facility " << f->id << " is not the last one of the route\n";
+                return false;
+            }
+            route.push_back(f);
+        }
+
+        setArrivals(src->gen, src->a, src->b, src->start, src->limit);
+        line.clear();
+        for (Facility* f : route)
+            addStage(f->servers, f->gen, f->a, f->b);
+        return true;
+    }
+
+    /**
+     * @brief Number of replications
+     */
+    int Ensemble::replications() const
+    {
+        return reps;
+    }
+
+    /**
+     * @brief Number of facilities in the line
+     */
+    int Ensemble::stages() const
+    {
+        return line.size();
+    }
+
+    /**
+     * @brief Statistics of one facility in one replication after run
+     *
+     * @param replication index of the replication
+     * @param stage index of the facility in the line
+     * @return statistics in the same form as Facility::stats
+     */
+    Facility::FacilityStats Ensemble::stats(int replication, int stage) const
+    {
+        const Stage& s = line.at(stage);
+        Facility::FacilityStats st;
+        st.processCnt = (int)s.cnt.at(replication);
+        st.waitTimeTotal = s.wait[replication];
+        st.workTimeTotal = s.work[replication];
+        return st;
+    }
+
+    /**
+     * @brief Integral of the queue length of one facility in one replication over [warmup, endTime] after run
+     *
+     * Measured from the waiting intervals of customers cut to the window, divided by the window
+     * length it is the time average queue length
+     *
+     * @param replication index of the replication
+     * @param stage index of the facility in the line
+     */
+    double Ensemble::queueArea(int replication, int stage) const
+    {
+        return line.at(stage).queue.at(replication);
+    }
+
+    /**
+     * @brief Draw one uniform variate in [0,1) for every replication (splitmix64)
+     *
+     * The top 52 bits fill the mantissa of a double in [1,2), uint64 to double conversion
+     * would keep the loop scalar
+     *
+     * @param out array of replications values
+     */
+    void Ensemble::uniforms(double* out)
+    {
+        uint64_t* __restrict state = rng.data();
+        double* __restrict u = out;
+        const int n = reps;
+#pragma omp simd
+        for (int r = 0; r < n; r++)
+        {
+            uint64_t z = (state[r] += 0x9E3779B97F4A7C15ULL);
+            z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+            z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+            z ^= z >> 31;
+            uint64_t bits = (z >> 12) | 0x3FF0000000000000ULL;
+            double d;
+            memcpy(&d, &bits, sizeof(d));
+            u[r] = d - 1.0;
+        }
+    }
+
+    /**
+     * @brief Draw one variate of a distribution for every replication
+     *
+     * Parameters have the same meaning as in Facility::generateTime. Logarithms use laneLog,
+     * cos of Normal and exp of LogNormal are libm calls in separate scalar loops
+     *
+     * @param g distribution
+     * @param a first parameter
+     * @param b second parameter
+     * @param out array of replications values
+     */
+    void Ensemble::sample(Facility::GenType g, double a, double b, double* out)
+    {
+        double* __restrict x = out;
+        double* __restrict v = scratch.data();
+        const int n = reps;
+        switch (g)
+        {
+            case Facility::GenType::Deterministic:
+#pragma omp simd
+                for (int r = 0; r < n; r++)
+                    x[r] = a;
+                break;
+
+            case Facility::GenType::Exp:
+                uniforms(x);
+#pragma omp simd
+                for (int r = 0; r < n; r++)
+                    x[r] = -laneLog(1.0 - x[r]) / a;
+                break;
+
+            case Facility::GenType::Normal:
+            case Facility::GenType::LogNormal:
+            {
+                // Box-Muller, one variate per pair of uniforms
+                uniforms(x);
+                uniforms(v);
+                const double twoPi = 6.283185307179586;
+                const bool clamp = g == Facility::GenType::Normal;
+                for (int r = 0; r < n; r++)
+                    v[r] = std::cos(twoPi * v[r]);
+#pragma omp simd
+                for (int r = 0; r < n; r++)
+                {
+                    double y = a + b * std::sqrt(-2.0 * laneLog(1.0 - x[r])) * v[r];
+                    x[r] = (clamp & (y < 0)) ? 0 : y;
+                }
+                if (g == Facility::GenType::LogNormal)
+                    for (int r = 0; r < n; r++)
+                        x[r] = std::exp(x[r]);
+                break;
+            }
+
+            case Facility::GenType::Erlang:
+            {
+                // product of a uniforms, one logarithm per ERLANG_CHUNK phases. Every factor
+                // 1 - u is at least 2^-52, so a chunk product stays a normal number for laneLog
+                double* __restrict p = chunk.data();
+                const int phases = (int)a;
+#pragma omp simd
+                for (int r = 0; r < n; r++)
+                    x[r] = 0.0;
+                for (int k = 0; k < phases; k += ERLANG_CHUNK)
+                {
+#pragma omp simd
+                    for (int r = 0; r < n; r++)
+                        p[r] = 1.0;
+                    for (int j = k; j < phases && j < k + ERLANG_CHUNK; j++)
+                    {
+                        uniforms(v);
+#pragma omp simd
+                        for (int r = 0; r < n; r++)
+                            p[r] *= 1.0 - v[r];
+                    }
+#pragma omp simd
+                    for (int r = 0; r < n; r++)
+                        x[r] -= laneLog(p[r]);
+                }
+#pragma omp simd
+                for (int r = 0; r < n; r++)
+                    x[r] /= b;
+                break;
+            }
+
+            case Facility::GenType::Uniform:
+            default:
+                uniforms(x);
+#pragma omp simd
+                for (int r = 0; r < n; r++)
+                    x[r] = a + (b - a) * x[r];
+                break;
+        }
+    }
+
+    /**
+     * @brief Simulate all replications from empty facilities until endTime
+     *
+     * Lane loop bodies are straight line code: operands are loaded into locals first, every
+     * select picks between locals or a value and 0.0, conditions are joined with &. Jump
+     * threading then finds no paths to duplicate and if-conversion keeps the loops vectorizable
+     *
+     * @param endTime end of the simulated period
+     * @param warmup events before this time are not counted in statistics
+     */
+    void Ensemble::run(double endTime, double warmup)
+    {
+        for (Stage& s : line)
+        {
+            s.freeAt.assign((size_t)s.servers * reps, arrStart);
+            s.cnt.assign(reps, 0);
+            s.wait.assign(reps, 0);
+            s.work.assign(reps, 0);
+            s.queue.assign(reps, 0);
+        }
+
+        std::vector<double> arrivalBuf(reps, arrStart); // arrival time of the current customer to the line
+        std::vector<double> activeBuf(reps, 1.0);       // 1 while the replication still has arrivals before endTime
+        std::vector<double> atBuf(reps);                // arrival time of the current customer to the current stage
+        std::vector<double> serviceBuf(reps);
+        std::vector<double> startBuf(reps);
+        std::vector<double> serverBuf(reps);            // index of the chosen server, double to keep lanes of one width
+        std::vector<double> gapBuf(reps);
+        double* __restrict arrival = arrivalBuf.data();
+        double* __restrict active = activeBuf.data();
+        double* __restrict at = atBuf.data();
+        double* __restrict service = serviceBuf.data();
+        double* __restrict start = startBuf.data();
+        double* __restrict server = serverBuf.data();
+        double* __restrict gap = gapBuf.data();
+        const int n = reps;
+        long customers = 0;
+        bool any = arrStart <= endTime && arrLimit != 0;
+
+        while (any)
+        {
+#pragma omp simd
+            for (int r = 0; r < n; r++)
+                at[r] = arrival[r];
+
+            for (Stage& s : line)
+            {
+                sample(s.gen, s.a, s.b, service);
+
+                // earliest free server of every replication
+                const double* __restrict free0 = s.freeAt.data();
+#pragma omp simd
+                for (int r = 0; r < n; r++)
+                {
+                    start[r] = free0[r];
+                    server[r] = 0;
+                }
+                for (int k = 1; k < s.servers; k++)
+                {
+                    const double* __restrict free = &s.freeAt[(size_t)k * n];
+                    const double index = k;
+#pragma omp simd
+                    for (int r = 0; r < n; r++)
+                    {
+                        // operands are loaded before the select, a select of two loads becomes a conditional load
+                        double f = free[r], st = start[r], sv = server[r];
+                        server[r] = f < st ? index : sv;
+                    }
+                    // second pass, two selects on one comparison are not if-converted
+#pragma omp simd
+                    for (int r = 0; r < n; r++)
+                    {
+                        double f = free[r], st = start[r];
+                        start[r] = f < st ? f : st;
+                    }
+                }
+
+                double* __restrict cnt = s.cnt.data();
+                double* __restrict wait = s.wait.data();
+                double* __restrict work = s.work.data();
+                double* __restrict queue = s.queue.data();
+#pragma omp simd
+                for (int r = 0; r < n; r++)
+                {
+                    // active is 0 or 1, & instead of &&, short circuit comparisons are branches
+                    double in = at[r], free = start[r], on = active[r], len = service[r];
+                    double st = in > free ? in : free;
+                    double seized = ((in >= warmup) & (in <= endTime)) ? on : 0.0;
+                    double started = ((st >= warmup) & (st <= endTime)) ? on : 0.0;
+                    // waiting interval [at, st) cut to [warmup, endTime]
+                    double from = in > warmup ? in : warmup;
+                    double to = st < endTime ? st : endTime;
+                    double waited = to - from;
+                    waited = waited > 0 ? waited : 0.0;
+                    cnt[r] += seized;
+                    wait[r] += started * (st - in);
+                    work[r] += started * len;
+                    queue[r] += on * waited;
+                    start[r] = st;
+                    at[r] = st + len;
+                }
+                for (int k = 0; k < s.servers; k++)
+                {
+                    double* __restrict free = &s.freeAt[(size_t)k * n];
+                    const double index = k;
+#pragma omp simd
+                    for (int r = 0; r < n; r++)
+                    {
+                        double done = at[r], f = free[r];
+                        free[r] = ((active[r] > 0) & (server[r] == index)) ? done : f;
+                    }
+                }
+            }
+
+            customers++;
+            if (arrLimit >= 0 && customers >= arrLimit)
+                break;
+            sample(arrGen, arrA, arrB, gap);
+            double left = 0;
+#pragma omp simd reduction(+:left)
+            for (int r = 0; r < n; r++)
+            {
+                arrival[r] += gap[r];
+                active[r] = arrival[r] <= endTime ? active[r] : 0.0;
+                left += active[r];
+            }
+            any = left > 0;
+        }
+    }
+/**********ENSEMBLE**********/
@@ -0,0 +1,83 @@
+/**
+ * @file ensemble.hpp
+ * @author Adam Hos <xhosad00>
+ * @brief Lockstep ensemble of replications of a simple queueing network
+ *
+ * Network is one arrival source followed by a line of facilities and exit, the same as an
+ * ArrivalSource with its route. Replications are simulated together, customer by customer,
+ * with all state stored as structure of arrays across replications. Every update is one loop
+ * over replications (lanes) marked `#pragma omp simd`, the Makefile builds with -fopenmp-simd
+ * so the lane loops are vectorized at -O2 without OpenMP runtime. Each replication has its
+ * own random stream
+ */
+
+#ifndef ENSEMBLE_HPP
+#define ENSEMBLE_HPP
+
+#include "discreteSim.hpp"
+
+    /**
+     * @brief The Ensemble class simulates many independent replications of a facility line in lockstep
+     *
+     * Facility statistics follow Simulation: processCnt counts processes seizing the facility,
+     * waitTimeTotal and workTimeTotal are added when service starts, only events in
+     * [warmup, endTime] are counted. Facilities with more than one server are supported only as
+     * the last stage, where the service order does not change the order of later arrivals.
+     * Only two-parameter distributions are supported, table types (Empirical, Discrete,
+     * HyperExp, PhaseType) are rejected.
+     *
+     * Statistics are exactly equal to those of Simulation only for a line with deterministic
+     * inter-arrival and service times. With random times the ensemble draws from its own
+     * streams, replications then agree with Simulation in distribution, not sample by sample
+     */
+    class Ensemble
+    {
+    public:
+        explicit Ensemble(int replications, unsigned int seed = SEED);
+
+        void setArrivals(Facility::GenType g, double a, double b, double start = 0, int limit = -1);
+        void addStage(int servers, Facility::GenType g, double a, double b);
+        bool loadRoute(Simulation* sim, int sourceID);
+        void run(double endTime, double warmup = 0);
+
+        int replications() const;
+        int stages() const;
+        Facility::FacilityStats stats(int replication, int stage) const;
+        double queueArea(int replication, int stage) const;
+
+    private:
+        static const int ERLANG_CHUNK = 16; ///< Erlang phases multiplied before a logarithm, 16 factors of at least 2^-52 stay normal
+
+        /**
+         * @brief Facility of the line with its per replication state
+         */
+        struct Stage
+        {
+            int servers;                ///< Number of servers of the facility
+            Facility::GenType gen;      ///< Service time distribution
+            double a;                   ///< First service distribution parameter
+            double b;                   ///< Second service distribution parameter
+            std::vector<double> freeAt; ///< Time the server becomes free, [server * replications + replication]
+            std::vector<double> cnt;    ///< Processes that seized the facility
+            std::vector<double> wait;   ///< Total wait time
+            std::vector<double> work;   ///< Total work time
+            std::vector<double> queue;  ///< Integral of the queue length over [warmup, endTime]
+        };
+
+        int reps;                       ///< Number of replications
+        Facility::GenType arrGen;       ///< Inter-arrival time distribution
+        double arrA;                    ///< First inter-arrival distribution parameter
+        double arrB;                    ///< Second inter-arrival distribution parameter
+        double arrStart;                ///< Time of the first arrival
+        int arrLimit;                   ///< Maximal number of arrivals of every replication, -1 if unlimited
+        std::vector<Stage> line;        ///< Facilities in the order they are visited
+        std::vector<uint64_t> rng;      ///< Random generator state of each replication
+        std::vector<double> scratch;    ///< Scratch variates
+        std::vector<double> chunk;      ///< Product of a chunk of Erlang phases
+
+        static bool supported(Facility::GenType g);
+        void uniforms(double* out);
+        void sample(Facility::GenType g, double a, double b, double* out);
+    };
+
+#endif // ENSEMBLE_HPP
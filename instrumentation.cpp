@@ -0,0 +1,138 @@
+/**
+ * @file instrumentation.cpp
+ * @author Adam Hos <xhosad00>
+ * @brief Opt-in engine instrumentation of the Simulation
+ */
+
+#include "instrumentation.hpp"
+
+#include <cmath>
+#include <cstdio>
+
+/**********LATENCY HISTOGRAM**********/
+    /**
+     * @brief Construct an empty histogram
+     */
+    LatencyHistogram::LatencyHistogram()
+    {
+        reset();
+    }
+
+    /**
+     * @brief Add one latency sample
+     *
+     * @param ns latency in nanoseconds
+     */
+    void LatencyHistogram::add(double ns)
+    {
+        int bucket = 0;
+        if (ns >= 1)
+            bucket = std::ilogb(ns);
+        if (bucket >= BUCKETS)
+            bucket = BUCKETS - 1;
+        counts[bucket]++;
+        samples++;
+        totalNs += ns;
+    }
+
+    /**
+     * @brief Mean of sampled latencies
+     *
+     * @return mean latency in nanoseconds, 0 if there are no samples
+     */
+    double LatencyHistogram::mean() const
+    {
+        return samples ? totalNs / samples : 0;
+    }
+
+    /**
+     * @brief Approximate percentile of sampled latencies
+     *
+     * @param q quantile in [0,1]
+     * @return upper bound of the bucket holding the quantile in nanoseconds, 0 if there are no samples
+     */
+    double LatencyHistogram::percentile(double q) const
+    {
+        if (!samples)
+            return 0;
+        unsigned long rank = (unsigned long)std::ceil(q * samples);
+        unsigned long seen = 0;
+        for (int i = 0; i < BUCKETS; i++)
+        {
+            seen += counts[i];
+            if (seen >= rank && seen > 0)
+                return std::ldexp(1.0, i + 1);
+        }
+        return std::ldexp(1.0, BUCKETS);
+    }
+
+    /**
+     * @brief Remove all samples
+     */
+    void LatencyHistogram::reset()
+    {
+        for (int i = 0; i < BUCKETS; i++)
+            counts[i] = 0;
+        samples = 0;
+        totalNs = 0;
+    }
+/**********LATENCY HISTOGRAM**********/
+
+
+/**********INSTRUMENTATION**********/
+    /**
+     * @brief Construct a new Instrumentation object
+     *
+     * @param sampleEvery every n-th dispatch is timed, 0 disables timing
+     */
+    Instrumentation::Instrumentation(int sampleEvery) : sampleEvery(sampleEvery), dumpInterval(0), nextDump(0), dumpStream(&std::cout)
+    {
+        reset();
+    }
+
+    /**
+     * @brief Total number of dispatched events
+     */
+    unsigned long Instrumentation::events() const
+    {
+        return processEvents + facilityEvents + customEvents;
+    }
+
+    /**
+     * @brief Reset all counters and histograms, periodic dumps start again from time 0
+     */
+    void Instrumentation::reset()
+    {
+        processEvents = 0;
+        facilityEvents = 0;
+        customEvents = 0;
+        calendarSize = 0;
+        peakCalendar = 0;
+        peakQueue.clear();
+        dispatch.reset();
+        behavior.reset();
+        sampling = false;
+        sampleCntr = 0;
+        nextDump = dumpInterval;
+    }
+
+    /**
+     * @brief Print collected statistics
+     *
+     * @param os output stream
+     * @param time current simulation time
+     */
+    void Instrumentation::print(std::ostream& os, double time) const
+    {
+        char line[256];
+        snprintf(line, sizeof(line), "[%.3lf] events: %lu (process %lu, facility %lu, custom %lu)  calendar: %zu (peak %zu)\n",
+            time, events(), processEvents, facilityEvents, customEvents, calendarSize, peakCalendar);
+        os << line;
+        snprintf(line, sizeof(line), "  dispatch ns: mean %.0lf p50 %.0lf p99 %.0lf  behavior ns: mean %.0lf p50 %.0lf p99 %.0lf  (%lu samples)\n",
+            dispatch.mean(), dispatch.percentile(0.5), dispatch.percentile(0.99),
+            behavior.mean(), behavior.percentile(0.5), behavior.percentile(0.99), dispatch.samples);
+        os << line;
+        for (auto& q : peakQueue)
+            os << "  facility " << q.first << " peak queue: " << q.second << "\n";
+    }
+/**********INSTRUMENTATION**********/
@@ -0,0 +1,97 @@
+/**
+ * @file instrumentation.hpp
+ * @author Adam Hos <xhosad00>
+ * @brief Opt-in engine instrumentation of the Simulation
+ *
+ * Counts dispatched events by type, tracks calendar and facility queue depths and
+ * keeps sampled wall-clock latency histograms of event dispatch and behavior calls
+ */
+
+#ifndef INSTRUMENTATION_HPP
+#define INSTRUMENTATION_HPP
+
+#include <chrono>
+#include <iostream>
+#include <unordered_map>
+
+    /**
+     * @brief Histogram of latencies with power of two buckets in nanoseconds
+     */
+    class LatencyHistogram
+    {
+    public:
+        static const int BUCKETS = 40;      ///< Bucket i holds latencies in [2^i, 2^(i+1)) ns
+        unsigned long counts[BUCKETS];      ///< Number of samples in each bucket
+        unsigned long samples;              ///< Total number of samples
+        double totalNs;                     ///< Sum of all sampled latencies
+
+        LatencyHistogram();
+
+        void add(double ns);
+        double mean() const;
+        double percentile(double q) const;
+        void reset();
+    };
+
+    /**
+     * @brief The Instrumentation class collects engine statistics of one Simulation
+     *
+     * Enabled by Simulation::enableInstrumentation, disabled Simulation only checks a null pointer per event
+     */
+    class Instrumentation
+    {
+    public:
+        typedef std::chrono::steady_clock Clock;
+
+        unsigned long processEvents;    ///< Number of dispatched process events
+        unsigned long facilityEvents;   ///< Number of dispatched facility exit events
+        unsigned long customEvents;     ///< Number of custom events returned to the caller
+        size_t calendarSize;            ///< Calendar size at the last dispatch
+        size_t peakCalendar;            ///< Highest calendar size seen at dispatch
+        std::unordered_map<int, size_t> peakQueue;  ///< Highest queue length of each facility
+        LatencyHistogram dispatch;      ///< Sampled latency of executeEvent, including behavior
+        LatencyHistogram behavior;      ///< Sampled latency of process behavior calls
+        int sampleEvery;                ///< Every n-th dispatch is timed
+        bool sampling;                  ///< True while the current dispatch is timed
+
+        double dumpInterval;            ///< Simulated time between periodic dumps, 0 if disabled
+        double nextDump;                ///< Simulated time of the next periodic dump
+        std::ostream* dumpStream;       ///< Stream periodic dumps are written to
+
+        Instrumentation(int sampleEvery = 64);
+
+        /**
+         * @brief Decide if the next dispatch is timed
+         *
+         * @return true if the dispatch should be timed
+         */
+        bool startDispatch()
+        {
+            sampling = sampleEvery > 0 && ++sampleCntr >= (unsigned long)sampleEvery;
+            if (sampling)
+                sampleCntr = 0;
+            return sampling;
+        }
+
+        /**
+         * @brief Record queue length of a facility after a process entered the queue
+         *
+         * @param facilityID ID of the facility
+         * @param len current queue length
+         */
+        void queueLength(int facilityID, size_t len)
+        {
+            size_t& peak = peakQueue[facilityID];
+            if (len > peak)
+                peak = len;
+        }
+
+        unsigned long events() const;
+        void reset();
+        void print(std::ostream& os, double time) const;
+
+    private:
+        unsigned long sampleCntr;       ///< Dispatches since the last timed one
+    };
+
+#endif // INSTRUMENTATION_HPP
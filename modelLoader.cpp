@@ -0,0 +1,475 @@
+/**
+ * @file modelLoader.cpp
+ * @author Adam Hos <xhosad00>
+ * @brief Loader of declarative text models into the Simulation
+ *
+ * The parser walks the model text once, tokens are views into the loaded text
+ * and numbers are converted in place, so only the simulation objects themselves allocate.
+ * A model that fails to load leaves the simulation unchanged
+ */
+
+#include "modelLoader.hpp"
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <unordered_set>
+
+/**
+ * @brief Position of the parser in the model text
+ */
+struct ModelCursor
+{
+    const char* p;      ///< Current position
+    const char* end;    ///< End of the model text
+    int line;           ///< Current line number, for error messages
+    const char* name;   ///< Name of the model, for error messages
+};
+
+/**
+ * @brief Part of a model applied to the Simulation only after the whole text is checked
+ *
+ * Facilities plan no events and are created while parsing, only their IDs are kept so a failed
+ * load can remove them
+ */
+struct ModelStage
+{
+    /**
+     * @brief Parsed source line
+     */
+    struct SourceLine
+    {
+        int id;             ///< Source ID
+        Distribution dist;  ///< Inter-arrival time distribution
+        double start;       ///< Time of the first arrival
+        int limit;          ///< Maximal number of arrivals, -1 if unlimited
+    };
+
+    std::deque<int> facilities;             ///< IDs of facilities created by this load, deque grows without moving a large buffer
+    std::vector<SourceLine> sources;        ///< Sources in file order, their arrivals are planned in this order
+    std::unordered_set<int> sourceIDs;      ///< IDs of staged sources
+    std::unordered_map<int, std::vector<int>> routes;   ///< Routes by source ID
+    double end;         ///< End time of the simulation
+    bool hasEnd;        ///< End time was given
+};
+
+    /**
+     * @brief Print parse error with model name and line
+     *
+     * @param c parser cursor
+     * @param msg error message
+     * @return false, so errors can be returned directly
+     */
+    static bool modelError(const ModelCursor& c, const char* msg)
+    {
+        std::cerr << c.name << ":" << c.line << ": " << msg << "\n";
+        return false;
+    }
+
+    /**
+     * @brief Skip blanks and comment on the current line, stops at the line end
+     *
+     * @param c parser cursor
+     */
+    static void skipBlank(ModelCursor& c)
+    {
+        while (c.p < c.end && (*c.p == ' ' || *c.p == '\t' || *c.p == '\r'))
+            c.p++;
+        if (c.p < c.end && *c.p == '#')
+            while (c.p < c.end && *c.p != '\n')
+                c.p++;
+    }
+
+    /**
+     * @brief Check if there are no more tokens on the current line
+     *
+     * @param c parser cursor
+     * @return true if at the end of line or end of text
+     */
+    static bool atLineEnd(ModelCursor& c)
+    {
+        skipBlank(c);
+        return c.p >= c.end || *c.p == '\n';
+    }
+
+    /**
+     * @brief Move the cursor to the start of the next line
+     *
+     * @param c parser cursor
+     */
+    static void nextLine(ModelCursor& c)
+    {
+        const char* nl = static_cast<const char*>(memchr(c.p, '\n', c.end - c.p));
+        c.p = nl ? nl + 1 : c.end;
+        c.line++;
+    }
+
+    /**
+     * @brief Read next whitespace separated token on the current line
+     *
+     * @param c parser cursor
+     * @param tok start of the token
+     * @param len length of the token
+     * @return false if there is no token left on the line
+     */
+    static bool nextToken(ModelCursor& c, const char*& tok, size_t& len)
+    {
+        if (atLineEnd(c))
+            return false;
+        tok = c.p;
+        while (c.p < c.end && *c.p != ' ' && *c.p != '\t' && *c.p != '\r' && *c.p != '\n')
+            c.p++;
+        len = c.p - tok;
+        return true;
+    }
+
+    /**
+     * @brief Check if token equals a keyword
+     */
+    static bool tokenIs(const char* tok, size_t len, const char* word)
+    {
+        return strlen(word) == len && memcmp(tok, word, len) == 0;
+    }
+
+    /**
+     * @brief Read next token as an integer
+     *
+     * @param c parser cursor
+     * @param val parsed value
+     * @return false if there is no token or it is not an integer
+     */
+    static bool nextInt(ModelCursor& c, int& val)
+    {
+        const char* tok;
+        size_t len;
+        if (!nextToken(c, tok, len))
+            return false;
+        size_t i = 0;
+        bool neg = false;
+        if (tok[0] == '-' || tok[0] == '+')
+        {
+            neg = tok[0] == '-';
+            i++;
+        }
+        if (i == len)
+            return false;
+        long v = 0;
+        for (; i < len; i++)
+        {
+            if (tok[i] < '0' || tok[i] > '9' || v > 100000000)
+                return false;
+            v = v * 10 + (tok[i] - '0');
+        }
+        val = (int)(neg ? -v : v);
+        return true;
+    }
+
+    /**
+     * @brief Read next token as a floating point number
+     *
+     * @param c parser cursor
+     * @param val parsed value
+     * @return false if there is no token or it is not a number
+     */
+    static bool nextDouble(ModelCursor& c, double& val)
+    {
+        const char* tok;
+        size_t len;
+        char buf[64];
+        if (!nextToken(c, tok, len) || len >= sizeof(buf))
+            return false;
+        memcpy(buf, tok, len);
+        buf[len] = '\0';
+        char* endp;
+        val = strtod(buf, &endp);
+        return endp == buf + len;
+    }
+
+    /**
+     * @brief Read rows of a table distribution
+     *
+     * @param c parser cursor
+     * @param rows number of rows
+     * @param cols numbers in one row
+     * @param table rows stored by column, table[col][row]
+     * @return false if a number is missing
+     */
+    static bool nextTable(ModelCursor& c, int rows, int cols, std::vector<double> table[])
+    {
+        for (int i = 0; i < rows; i++)
+            for (int col = 0; col < cols; col++)
+            {
+                double v;
+                if (!nextDouble(c, v))
+                    return false;
+                table[col].push_back(v);
+            }
+        return true;
+    }
+
+    /**
+     * @brief Read next tokens as a distribution name and its parameters
+     *
+     * Two-parameter types are followed by a b, table types by a row count n and rows:
+     * empirical first edge then (edge weight) per bin, discrete (value weight),
+     * hyperexp (prob rate), phase (prob phases rate)
+     *
+     * @param c parser cursor
+     * @param d parsed distribution
+     * @return false if the distribution is unknown or invalid, error is already printed
+     */
+    static bool nextDistribution(ModelCursor& c, Distribution& d)
+    {
+        static const struct { const char* name; GenType g; } simple[] = {
+            {"uniform", GenType::Uniform}, {"exp", GenType::Exp}, {"normal", GenType::Normal},
+            {"det", GenType::Deterministic}, {"erlang", GenType::Erlang}, {"lognormal", GenType::LogNormal}
+        };
+        const char* tok;
+        size_t len;
+        if (!nextToken(c, tok, len))
+            return modelError(c, "expected distribution (uniform, exp, normal, det, erlang, lognormal, empirical, discrete, hyperexp, phase)");
+        try
+        {
+            for (const auto& s : simple)
+                if (tokenIs(tok, len, s.name))
+                {
+                    double a, b;
+                    if (!nextDouble(c, a) || !nextDouble(c, b))
+                        return modelError(c, "expected two distribution parameters");
+                    d = Distribution(s.g, a, b);
+                    return true;
+                }
+
+            int rows;
+            std::vector<double> table[3];
+            if (tokenIs(tok, len, "empirical"))
+            {
+                double first;
+                if (!nextInt(c, rows) || rows < 1 || !nextDouble(c, first) || !nextTable(c, rows, 2, table))
+                    return modelError(c, "expected bin count, first edge and (edge weight) per bin");
+                table[0].insert(table[0].begin(), first);
+                d = Distribution::empirical(table[0], table[1]);
+            }
+            else if (tokenIs(tok, len, "discrete"))
+            {
+                if (!nextInt(c, rows) || rows < 1 || !nextTable(c, rows, 2, table))
+                    return modelError(c, "expected value count and (value weight) per value");
+                d = Distribution::discrete(table[0], table[1]);
+            }
+            else if (tokenIs(tok, len, "hyperexp"))
+            {
+                if (!nextInt(c, rows) || rows < 1 || !nextTable(c, rows, 2, table))
+                    return modelError(c, "expected branch count and (prob rate) per branch");
+                d = Distribution::hyperExp(table[0], table[1]);
+            }
+            else if (tokenIs(tok, len, "phase"))
+            {
+                if (!nextInt(c, rows) || rows < 1 || !nextTable(c, rows, 3, table))
+                    return modelError(c, "expected branch count and (prob phases rate) per branch");
+                std::vector<int> phases(table[1].begin(), table[1].end());
+                for (size_t i = 0; i < phases.size(); i++)
+                    if (phases[i] != table[1][i])
+                        return modelError(c, "phase count must be an integer");
+                d = Distribution::phaseType(table[0], phases, table[2]);
+            }
+            else
+                return modelError(c, "unknown distribution");
+        }
+        catch (const std::invalid_argument& e)
+        {
+            return modelError(c, e.what());
+        }
+        return true;
+    }
+
+    /**
+     * @brief Parse rest of a facility line, the facility is created in sim right away
+     */
+    static bool parseFacility(Simulation* sim, ModelStage& m, ModelCursor& c)
+    {
+        int id, cap;
+        const char* name;
+        size_t nameLen;
+        Distribution d;
+        if (!nextInt(c, id) || id < 0)
+            return modelError(c, "expected non-negative facility id");
+        if (!nextToken(c, name, nameLen))
+            return modelError(c, "expected facility name");
+        if (!nextInt(c, cap) || cap < 1)
+            return modelError(c, "expected positive facility capacity");
+        if (!nextDistribution(c, d))
+            return false;
+        if (sim->facMap.count(id))
+            return modelError(c, "duplicate facility id");
+        sim->createFacility(id, std::string(name, nameLen), cap, d);
+        m.facilities.push_back(id);
+        return true;
+    }
+
+    /**
+     * @brief Parse rest of a source line into the stage
+     */
+    static bool parseSource(const Simulation* sim, ModelStage& m, ModelCursor& c)
+    {
+        ModelStage::SourceLine s;
+        s.limit = -1;
+        s.start = 0;
+        if (!nextInt(c, s.id))
+            return modelError(c, "expected source id");
+        if (!nextDistribution(c, s.dist))
+            return false;
+        if (!atLineEnd(c) && !nextDouble(c, s.start))
+            return modelError(c, "invalid source start time");
+        if (!atLineEnd(c) && !nextInt(c, s.limit))
+            return modelError(c, "invalid source limit");
+        if (sim->srcMap.count(s.id) || !m.sourceIDs.insert(s.id).second)
+            return modelError(c, "duplicate source id");
+        if (std::isnan(s.start) || sim->getSimTime() > toSimTime(s.start))
+            return modelError(c, "source start time in the past");
+        m.sources.push_back(std::move(s));
+        return true;
+    }
+
+    /**
+     * @brief Parse rest of a route line into the stage, a later route of a source replaces the earlier one
+     */
+    static bool parseRoute(const Simulation* sim, ModelStage& m, ModelCursor& c)
+    {
+        int id, fac;
+        if (!nextInt(c, id))
+            return modelError(c, "expected source id");
+        if (!sim->srcMap.count(id) && !m.sourceIDs.count(id))
+            return modelError(c, "route for undefined source");
+        std::vector<int>& route = m.routes[id];
+        route.clear();
+        while (!atLineEnd(c))
+        {
+            if (!nextInt(c, fac) || fac < 0)
+                return modelError(c, "expected non-negative facility id");
+            route.push_back(fac);
+        }
+        if (route.empty())
+            return modelError(c, "empty route");
+        return true;
+    }
+
+    /**
+     * @brief Parse and check the whole model text
+     *
+     * @param sim simulation the model is loaded into
+     * @param m stage receiving sources, routes and end time, and IDs of created facilities
+     * @param c parser cursor at the start of the text
+     * @return false on the first error, which is printed to stderr
+     */
+    static bool parseModel(Simulation* sim, ModelStage& m, ModelCursor& c)
+    {
+        while (c.p < c.end)
+        {
+            const char* tok;
+            size_t tokLen;
+            if (nextToken(c, tok, tokLen))
+            {
+                bool ok;
+                if (tokenIs(tok, tokLen, "facility"))
+                    ok = parseFacility(sim, m, c);
+                else if (tokenIs(tok, tokLen, "source"))
+                    ok = parseSource(sim, m, c);
+                else if (tokenIs(tok, tokLen, "route"))
+                    ok = parseRoute(sim, m, c);
+                else if (tokenIs(tok, tokLen, "end"))
+                {
+                    ok = nextDouble(c, m.end) || modelError(c, "expected end time");
+                    m.hasEnd = ok;
+                }
+                else
+                    ok = modelError(c, "unknown keyword");
+                if (!ok)
+                    return false;
+                if (!atLineEnd(c))
+                    return modelError(c, "unexpected token at the end of line");
+            }
+            nextLine(c);
+        }
+
+        // routes may name facilities defined later in the file
+        for (const auto& r : m.routes)
+        {
+            for (int fac : r.second)
+            {
+                if (sim->facMap.find(fac) == sim->facMap.end())
+                {
+                    std::cerr << c.name << ": route of source " << r.first << " uses undefined facility " << fac << "\n";
+                    return false;
+                }
+            }
+        }
+        return true;
+    }
+
+    /**
+     * @brief Load model from text in memory into the simulation
+     *
+     * Loading is all or nothing. Facilities are created while parsing and removed again if the
+     * model is invalid, sources (which plan their first arrival), routes and the end time are
+     * applied only after the whole text is checked, so a failed load leaves sim as it was
+     *
+     * @param sim simulation the model is loaded into
+     * @param text model text, does not need to be null terminated
+     * @param len length of the text
+     * @param name model name used in error messages
+     * @return true if the whole model was loaded
+     * @return false on the first error, which is printed to stderr, nothing is loaded
+     */
+    bool loadModelString(Simulation* sim, const char* text, size_t len, const char* name)
+    {
+        ModelCursor c = {text, text + len, 1, name};
+        ModelStage m;
+        m.hasEnd = false;
+        if (!parseModel(sim, m, c))
+        {
+            for (int id : m.facilities)
+                sim->facMap.erase(id);
+            return false;
+        }
+
+        // model is valid, nothing below can fail
+        for (const ModelStage::SourceLine& s : m.sources)
+            sim->createArrivalSource(s.id, s.dist, s.start, s.limit);
+        for (auto& r : m.routes)
+            sim->findArrivalSource(r.first)->route = std::move(r.second);
+        if (m.hasEnd)
+            sim->setEndTime(m.end);
+        return true;
+    }
+
+    /**
+     * @brief Load model file into the simulation
+     *
+     * @param sim simulation the model is loaded into
+     * @param path path to the model file
+     * @return true if the whole model was loaded
+     * @return false if file could not be read or on the first parse error, which is printed to stderr
+     */
+    bool loadModel(Simulation* sim, const char* path)
+    {
+        FILE* f = fopen(path, "rb");
+        if (!f)
+        {
+            std::cerr << "Could not open model: " << path << "\n";
+            return false;
+        }
+        fseek(f, 0, SEEK_END);
+        long size = ftell(f);
+        fseek(f, 0, SEEK_SET);
+        std::vector<char> text(size > 0 ? size : 0);
+        size_t read = size > 0 ? fread(text.data(), 1, size, f) : 0;
+        fclose(f);
+        if ((long)read != size)
+        {
+            std::cerr << "Could not read model: " << path << "\n";
+            return false;
+        }
+        return loadModelString(sim, text.data(), text.size(), path);
+    }
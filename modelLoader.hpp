@@ -0,0 +1,31 @@
+/**
+ * @file modelLoader.hpp
+ * @author Adam Hos <xhosad00>
+ * @brief Loader of declarative text models into the Simulation
+ *
+ * Model file is line based, '#' starts a comment. Supported lines:
+ *
+ *     facility <id> <name> <capacity> <distribution> <a> <b>
+ *     source   <id> <distribution> <a> <b> [start] [limit]
+ *     route    <sourceID> <facilityID> [facilityID ...]
+ *     end      <time>
+ *
+ * where distribution is one of uniform, exp, normal, det, erlang, lognormal and (a,b) are its
+ * parameters with the same meaning as in GenType, or a table distribution with a row count n
+ * in place of (a,b) followed by n rows:
+ *
+ *     empirical <n> <edge0> (<edge> <weight>)...
+ *     discrete  <n> (<value> <weight>)...
+ *     hyperexp  <n> (<prob> <rate>)...
+ *     phase     <n> (<prob> <phases> <rate>)...
+ */
+
+#ifndef MODEL_LOADER_HPP
+#define MODEL_LOADER_HPP
+
+#include "discreteSim.hpp"
+
+    bool loadModel(Simulation* sim, const char* path);
+    bool loadModelString(Simulation* sim, const char* text, size_t len, const char* name = "<string>");
+
+#endif // MODEL_LOADER_HPP
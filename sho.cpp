@@ -89,7 +89,7 @@ int main(int argc, char* argv[])
         if (e.canProcessEvent())
         {
             if (Verbose)
-                printf("%2.1lf: Proc:%d\n", e.startTime, e.processID);
+                printf("%2.1lf: Proc:%d\n", fromSimTime(e.startTime), e.processID);
             sim->executeEvent(e);
         }
     }
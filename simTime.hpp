@@ -0,0 +1,112 @@
+/**
+ * @file simTime.hpp
+ * @author Adam Hos <xhosad00>
+ * @brief Internal representation of simulation time
+ *
+ * By default simulation time is a double. Compiled with DISCSIM_TICK_TIME (make TICK_TIME=1)
+ * the engine keeps time as 64-bit integer ticks, DISCSIM_TICK_RESOLUTION ticks per unit of time
+ * (default 1000000). Calendar keys are then plain integers and equal times are exactly equal,
+ * so the order of events does not depend on rounding of sums of delays. Public methods of
+ * Simulation take and return double time, every delay is rounded to the nearest tick once
+ * when it is planned. Event times and the calendar are in SimTime. Times are clamped to
+ * +-SIM_TIME_MAX ticks and delays are added to the clock by addSimTime, which saturates at
+ * SIM_TIME_MAX, so no tick arithmetic overflows. A NaN time and a NaN or negative delay are
+ * rejected with std::invalid_argument in both modes
+ */
+
+#ifndef SIM_TIME_HPP
+#define SIM_TIME_HPP
+
+#include <cstdint>
+#include <stdexcept>
+
+#ifdef DISCSIM_TICK_TIME
+
+#ifndef DISCSIM_TICK_RESOLUTION
+#define DISCSIM_TICK_RESOLUTION 1000000
+#endif
+
+    typedef int64_t SimTime;    ///< Simulation time in ticks
+
+    const SimTime SIM_TIME_MAX = (SimTime)1 << 62;  ///< Times are clamped to +-SIM_TIME_MAX, addSimTime saturates at SIM_TIME_MAX
+
+    /**
+     * @brief Convert time in units to ticks, rounded to the nearest tick
+     */
+    inline SimTime toSimTime(double time)
+    {
+        if (time != time)
+            throw std::invalid_argument("Simulation time is NaN");
+        double ticks = time * DISCSIM_TICK_RESOLUTION;
+        if (ticks >= (double)SIM_TIME_MAX)
+            return SIM_TIME_MAX;
+        if (ticks <= -(double)SIM_TIME_MAX)
+            return -SIM_TIME_MAX;
+        return (SimTime)(ticks < 0 ? ticks - 0.5 : ticks + 0.5);
+    }
+
+    /**
+     * @brief Convert ticks to time in units
+     */
+    inline double fromSimTime(SimTime time)
+    {
+        return (double)time / DISCSIM_TICK_RESOLUTION;
+    }
+
+    /**
+     * @brief Add a non-negative delay to a time, the sum saturates at SIM_TIME_MAX
+     *
+     * Both arguments are within +-SIM_TIME_MAX, so SIM_TIME_MAX - time does not overflow for
+     * positive time and a negative time plus the delay stays in range
+     */
+    inline SimTime addSimTime(SimTime time, SimTime delay)
+    {
+        return time > 0 && delay > SIM_TIME_MAX - time ? SIM_TIME_MAX : time + delay;
+    }
+
+#else
+
+    typedef double SimTime;     ///< Simulation time in units
+
+    /**
+     * @brief Convert time in units to SimTime, identity without DISCSIM_TICK_TIME
+     */
+    inline SimTime toSimTime(double time)
+    {
+        if (time != time)
+            throw std::invalid_argument("Simulation time is NaN");
+        return time;
+    }
+
+    /**
+     * @brief Convert SimTime to time in units, identity without DISCSIM_TICK_TIME
+     */
+    inline double fromSimTime(SimTime time)
+    {
+        return time;
+    }
+
+    /**
+     * @brief Add a delay to a time, infinity is the saturated value of double time
+     */
+    inline SimTime addSimTime(SimTime time, SimTime delay)
+    {
+        return time + delay;
+    }
+
+#endif
+
+    /**
+     * @brief Convert a delay in units to SimTime
+     *
+     * @param delay delay, must not be NaN or negative
+     * @return delay in SimTime, clamped to SIM_TIME_MAX with tick time
+     */
+    inline SimTime toSimDelay(double delay)
+    {
+        if (!(delay >= 0))
+            throw std::invalid_argument("Delay must not be NaN or negative");
+        return toSimTime(delay);
+    }
+
+#endif // SIM_TIME_HPP
@@ -0,0 +1,116 @@
+/**
+ * @file splitting.cpp
+ * @author Adam Hos <xhosad00>
+ * @brief Rare event estimation by fixed effort importance splitting
+ */
+
+#include "splitting.hpp"
+
+#include <algorithm>
+
+/**********SPLITTING**********/
+    /**
+     * @brief Run simulation until the facility queue reaches a length or the simulation finishes
+     *
+     * @param sim simulation to run
+     * @param f facility of sim
+     * @param length queue length to reach
+     * @param events incremented by the number of executed events
+     * @return true if the queue reached length, sim is left right after the event that reached it
+     */
+    bool runUntilQueue(Simulation& sim, Facility* f, size_t length, long& events)
+    {
+        while (f->q.size() < length)
+        {
+            if (sim.finished())
+                return false;
+            Event e = sim.nextEvent();
+            sim.executeEvent(e);
+            events++;
+        }
+        return true;
+    }
+
+    /**
+     * @brief Estimate probability that a facility queue reaches the last level before horizon
+     *
+     * Every stage runs effort clones of the entrance states, taken in turn, until the queue
+     * reaches the stage level or the horizon passes. States reaching the level are the entrance
+     * states of the next stage. Process data shared by clones (see Simulation copy) must not
+     * hold per run state, e.g. Channel or TraceSource
+     *
+     * @param initial simulation in its initial state, it is not modified
+     * @param facilityID ID of the observed facility
+     * @param levels increasing queue lengths, the last one is the rare event
+     * @param horizon simulation time the level must be reached before
+     * @param effort number of runs of every stage
+     * @param repetitions number of independent repetitions, at least 2 for the variance
+     * @return estimate with its variance
+     */
+    SplittingResult fixedEffortSplitting(const Simulation& initial, int facilityID, const std::vector<int>& levels,
+        double horizon, int effort, int repetitions)
+    {
+        if (levels.empty() || levels[0] < 1)
+            throw std::invalid_argument("Splitting needs positive levels");
+        for (size_t k = 1; k < levels.size(); k++)
+            if (levels[k] <= levels[k - 1])
+                throw std::invalid_argument("Splitting levels must increase");
+        if (effort < 1 || repetitions < 2)
+            throw std::invalid_argument("Splitting needs positive effort and at least two repetitions");
+        if (initial.facMap.find(facilityID) == initial.facMap.end())
+            throw std::invalid_argument("Splitting facility does not exist");
+
+        SplittingResult res;
+        res.levelProbability.assign(levels.size(), 0);
+        res.events = 0;
+        res.runs = 0;
+        std::vector<double> estimates;
+
+        // entrance states are assigned over old ones to reuse their memory
+        std::vector<Simulation> entrance, reached;
+        Simulation work;
+        for (int r = 0; r < repetitions; r++)
+        {
+            entrance.resize(std::max<size_t>(entrance.size(), 1));
+            entrance[0] = initial;
+            entrance[0].setEndTime(horizon);
+            size_t entranceCnt = 1;
+            double estimate = 1;
+            for (size_t k = 0; k < levels.size(); k++)
+            {
+                size_t hits = 0;
+                for (int i = 0; i < effort; i++)
+                {
+                    work = entrance[i % entranceCnt];
+                    res.runs++;
+                    if (!runUntilQueue(work, work.findFacility(facilityID), levels[k], res.events))
+                        continue;
+                    if (hits < reached.size())
+                        reached[hits] = work;
+                    else
+                        reached.push_back(work);
+                    hits++;
+                }
+                double fraction = (double)hits / effort;
+                res.levelProbability[k] += fraction / repetitions;
+                estimate *= fraction;
+                if (hits == 0)
+                    break;
+                entrance.swap(reached);
+                entranceCnt = hits;
+            }
+            estimates.push_back(estimate);
+        }
+
+        double mean = 0;
+        for (double e : estimates)
+            mean += e;
+        mean /= repetitions;
+        double var = 0;
+        for (double e : estimates)
+            var += (e - mean) * (e - mean);
+        res.probability = mean;
+        res.variance = var / (repetitions - 1) / repetitions;
+        return res;
+    }
+/**********SPLITTING**********/
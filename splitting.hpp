@@ -0,0 +1,34 @@
+/**
+ * @file splitting.hpp
+ * @author Adam Hos <xhosad00>
+ * @brief Rare event estimation by fixed effort importance splitting
+ *
+ * Estimates the probability that the queue of a facility reaches a length L before a time
+ * horizon. The way to L is divided by intermediate levels, every stage continues a fixed number
+ * of runs from clones of the states that reached the previous level and counts runs reaching
+ * the next one. The product of stage fractions is an unbiased estimate of the probability,
+ * its variance is taken from independent repetitions of the whole procedure
+ */
+
+#ifndef SPLITTING_HPP
+#define SPLITTING_HPP
+
+#include "discreteSim.hpp"
+
+    /**
+     * @brief Result of fixed effort splitting
+     */
+    struct SplittingResult
+    {
+        double probability;     ///< Mean of the repetition estimates
+        double variance;        ///< Variance of probability, from the spread of the repetition estimates
+        std::vector<double> levelProbability;   ///< Mean fraction of runs of a stage reaching its level
+        long events;            ///< Events executed in all runs
+        long runs;              ///< Number of runs in all stages and repetitions
+    };
+
+    bool runUntilQueue(Simulation& sim, Facility* f, size_t length, long& events);
+    SplittingResult fixedEffortSplitting(const Simulation& initial, int facilityID, const std::vector<int>& levels,
+        double horizon, int effort, int repetitions);
+
+#endif // SPLITTING_HPP
@@ -0,0 +1,137 @@
+/**
+ * @file timeSeries.cpp
+ * @author Adam Hos <xhosad00>
+ * @brief Sampled time series of facility state written by a background thread
+ */
+
+#include "timeSeries.hpp"
+
+#include <chrono>
+#include <iostream>
+
+/**********TIME SERIES WRITER**********/
+    /**
+     * @brief Open the output file and start the writer thread
+     *
+     * @param path path of the output file
+     * @param format output file format
+     * @param capacity number of samples the ring can hold before samples are dropped
+     */
+    TimeSeriesWriter::TimeSeriesWriter(const std::string& path, Format format, size_t capacity)
+        : format(format), ring(capacity), stopping(false), droppedCnt(0), writtenCnt(0)
+    {
+        file = fopen(path.c_str(), format == Format::CSV ? "w" : "wb");
+        if (!file)
+        {
+            std::cerr << "Could not open time series file: " << path << "\n";
+            return;
+        }
+        if (format == Format::CSV)
+            fputs("time,facility,queue,busy,processCnt,waitTimeTotal,workTimeTotal\n", file);
+        else
+            fwrite("SHOTS001", 1, 8, file);
+        writer = std::thread(&TimeSeriesWriter::run, this);
+    }
+
+    /**
+     * @brief Write remaining samples and close the file
+     */
+    TimeSeriesWriter::~TimeSeriesWriter()
+    {
+        close();
+    }
+
+    /**
+     * @brief Check if the output file is open
+     */
+    bool TimeSeriesWriter::isOpen() const
+    {
+        return file != nullptr;
+    }
+
+    /**
+     * @brief Pass sample to the writer thread, never blocks
+     *
+     * @param s sample to be written
+     * @return false if the sample was dropped (ring full or file not open)
+     */
+    bool TimeSeriesWriter::record(const FacilitySample& s)
+    {
+        if (file && ring.push(s))
+            return true;
+        droppedCnt++;
+        return false;
+    }
+
+    /**
+     * @brief Stop the writer thread after it writes all recorded samples and close the file
+     */
+    void TimeSeriesWriter::close()
+    {
+        if (!file)
+            return;
+        stopping.store(true, std::memory_order_release);
+        writer.join();
+        fclose(file);
+        file = nullptr;
+    }
+
+    /**
+     * @brief Number of samples dropped because the ring was full
+     */
+    unsigned long TimeSeriesWriter::dropped() const
+    {
+        return droppedCnt;
+    }
+
+    /**
+     * @brief Number of samples already written to the file
+     */
+    unsigned long TimeSeriesWriter::written() const
+    {
+        return writtenCnt.load(std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief Writer thread loop, sleeps briefly when there is nothing to write
+     */
+    void TimeSeriesWriter::run()
+    {
+        FacilitySample s;
+        while (true)
+        {
+            bool stop = stopping.load(std::memory_order_acquire);
+            bool any = false;
+            while (ring.pop(s))
+            {
+                write(s);
+                any = true;
+            }
+            if (stop)
+                break;
+            if (!any)
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        fflush(file);
+    }
+
+    /**
+     * @brief Write one sample to the file
+     */
+    void TimeSeriesWriter::write(const FacilitySample& s)
+    {
+        if (format == Format::CSV)
+        {
+            fprintf(file, "%.6f,%d,%d,%d,%d,%.6f,%.6f\n", s.time, s.facilityID, s.queueLen, s.busy, s.processCnt, s.waitTimeTotal, s.workTimeTotal);
+        }
+        else
+        {
+            int32_t ints[4] = {s.facilityID, s.queueLen, s.busy, s.processCnt};
+            fwrite(&s.time, sizeof(double), 1, file);
+            fwrite(ints, sizeof(int32_t), 4, file);
+            fwrite(&s.waitTimeTotal, sizeof(double), 1, file);
+            fwrite(&s.workTimeTotal, sizeof(double), 1, file);
+        }
+        writtenCnt.fetch_add(1, std::memory_order_relaxed);
+    }
+/**********TIME SERIES WRITER**********/
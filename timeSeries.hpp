@@ -0,0 +1,137 @@
+/**
+ * @file timeSeries.hpp
+ * @author Adam Hos <xhosad00>
+ * @brief Sampled time series of facility state written by a background thread
+ *
+ * Simulation thread pushes samples into a lock-free single-producer single-consumer ring,
+ * writer thread takes them out and writes them to a file. When the ring is full the sample
+ * is dropped and counted, the simulation thread never waits for disk
+ */
+
+#ifndef TIME_SERIES_HPP
+#define TIME_SERIES_HPP
+
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <thread>
+#include <vector>
+
+    /**
+     * @brief State of one facility at a sample time
+     */
+    struct FacilitySample
+    {
+        double time;            ///< Simulation time of the sample
+        int facilityID;         ///< The ID of the facility
+        int queueLen;           ///< Number of processes waiting in the queue
+        int busy;               ///< Number of busy servers
+        int processCnt;         ///< Cumulative count of processes that seized the facility
+        double waitTimeTotal;   ///< Cumulative wait time
+        double workTimeTotal;   ///< Cumulative work time
+    };
+
+    /**
+     * @brief Lock-free ring buffer for exactly one producer and one consumer thread
+     *
+     * @tparam T type of stored items
+     */
+    template <typename T>
+    class SpscRing
+    {
+    public:
+        /**
+         * @brief Construct a ring
+         *
+         * @param capacity minimal capacity, rounded up to a power of two
+         */
+        explicit SpscRing(size_t capacity) : head(0), tail(0)
+        {
+            size_t cap = 1;
+            while (cap < capacity)
+                cap <<= 1;
+            buf.resize(cap);
+            mask = cap - 1;
+        }
+
+        /**
+         * @brief Add item, called only by the producer
+         *
+         * @return false if the ring is full
+         */
+        bool push(const T& item)
+        {
+            size_t t = tail.load(std::memory_order_relaxed);
+            if (t - head.load(std::memory_order_acquire) > mask)
+                return false;
+            buf[t & mask] = item;
+            tail.store(t + 1, std::memory_order_release);
+            return true;
+        }
+
+        /**
+         * @brief Take item, called only by the consumer
+         *
+         * @return false if the ring is empty
+         */
+        bool pop(T& item)
+        {
+            size_t h = head.load(std::memory_order_relaxed);
+            if (h == tail.load(std::memory_order_acquire))
+                return false;
+            item = buf[h & mask];
+            head.store(h + 1, std::memory_order_release);
+            return true;
+        }
+
+    private:
+        std::vector<T> buf;         ///< Storage of the items
+        size_t mask;                ///< Capacity - 1
+        std::atomic<size_t> head;   ///< Count of taken items, written by the consumer
+        char pad[64];               ///< Keeps head and tail on different cache lines
+        std::atomic<size_t> tail;   ///< Count of added items, written by the producer
+    };
+
+    /**
+     * @brief The TimeSeriesWriter class writes facility samples to a file on a background thread
+     *
+     * CSV format has a header line, binary format starts with magic "SHOTS001" followed by
+     * FacilitySample fields in host byte order (double, 4x int32, 2x double per sample)
+     */
+    class TimeSeriesWriter
+    {
+    public:
+        /**
+         * @brief Output file format
+         */
+        enum class Format {
+            CSV,        ///< Text, one sample per line
+            Binary      ///< Packed binary records
+        };
+
+        TimeSeriesWriter(const std::string& path, Format format = Format::CSV, size_t capacity = 1 << 16);
+        ~TimeSeriesWriter();
+        TimeSeriesWriter(const TimeSeriesWriter&) = delete;
+        TimeSeriesWriter& operator=(const TimeSeriesWriter&) = delete;
+
+        bool isOpen() const;
+        bool record(const FacilitySample& s);
+        void close();
+        unsigned long dropped() const;
+        unsigned long written() const;
+
+    private:
+        FILE* file;                         ///< Output file, nullptr if it could not be opened
+        Format format;                      ///< Output file format
+        SpscRing<FacilitySample> ring;      ///< Samples waiting for the writer thread
+        std::atomic<bool> stopping;         ///< Set by close, writer thread drains the ring and ends
+        std::thread writer;                 ///< Background writer thread
+        unsigned long droppedCnt;           ///< Samples dropped because the ring was full
+        std::atomic<unsigned long> writtenCnt;  ///< Samples written to the file
+
+        void run();
+        void write(const FacilitySample& s);
+    };
+
+#endif // TIME_SERIES_HPP
@@ -0,0 +1,280 @@
+/**
+ * @file traceSource.cpp
+ * @author Adam Hos <xhosad00>
+ * @brief Trace driven arrivals replayed lazily from a memory-mapped file
+ */
+
+#include "traceSource.hpp"
+
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+const size_t TRACE_RELEASE_BYTES = 16 << 20;   ///< Replayed part of the trace is released from memory in blocks of this size
+
+/**********TRACE SOURCE**********/
+    /**
+     * @brief Map the trace file and parse its first record
+     *
+     * Only the first record is read, so opening takes the same time for any trace size
+     *
+     * @param path path to the trace file
+     */
+    TraceSource::TraceSource(const std::string& path)
+        : base(nullptr), len(0), format(Format::CSV), recordSize(0), binAttributes(0), cur(nullptr), curEnd(nullptr), curTime(0),
+          released(nullptr), arrived(0), behav(nullptr), state(0), prio(CREATE_PROCESS_PRIO)
+    {
+        int fd = open(path.c_str(), O_RDONLY);
+        if (fd < 0)
+        {
+            std::cerr << "Could not open trace: " << path << "\n";
+            return;
+        }
+        struct stat st;
+        if (fstat(fd, &st) != 0 || st.st_size == 0)
+        {
+            std::cerr << "Could not read trace or trace is empty: " << path << "\n";
+            ::close(fd);
+            return;
+        }
+        void* map = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        ::close(fd);
+        if (map == MAP_FAILED)
+        {
+            std::cerr << "Could not map trace: " << path << "\n";
+            return;
+        }
+        base = static_cast<const char*>(map);
+        len = st.st_size;
+        released = base;
+        madvise(map, len, MADV_SEQUENTIAL);
+
+        const char* first = base;
+        if (len >= 16 && memcmp(base, "SHOTR001", 8) == 0)
+        {
+            uint32_t attrs;
+            memcpy(&attrs, base + 8, sizeof(attrs));
+            format = Format::Binary;
+            binAttributes = attrs;
+            recordSize = sizeof(double) * (1 + attrs);
+            first = base + 16;
+        }
+        parseRecord(first);
+    }
+
+    /**
+     * @brief Unmap the trace file
+     */
+    TraceSource::~TraceSource()
+    {
+        if (base)
+            munmap(const_cast<char*>(base), len);
+    }
+
+    /**
+     * @brief Check if the trace file is mapped
+     */
+    bool TraceSource::isOpen() const
+    {
+        return base != nullptr;
+    }
+
+    /**
+     * @brief Get format of the trace
+     */
+    TraceSource::Format TraceSource::getFormat() const
+    {
+        return format;
+    }
+
+    /**
+     * @brief Number of processes created from the trace so far
+     */
+    unsigned long TraceSource::arrivals() const
+    {
+        return arrived;
+    }
+
+    /**
+     * @brief Plan the first arrival of the trace
+     *
+     * @param sim simulation the arrivals are replayed into
+     * @param behav behavior of created processes, their data points to their trace record
+     * @param state initial state of created processes
+     * @param prio priority of process creation
+     * @return false if the trace is not open or is empty
+     */
+    bool TraceSource::start(Simulation* sim, void (*behav)(Process*, void*), int state, int prio)
+    {
+        if (!base || !cur)
+            return false;
+        this->behav = behav;
+        this->state = state;
+        this->prio = prio;
+        double at = curTime > sim->getTime() ? curTime : sim->getTime();
+        return sim->createProcessAtTime(at, traceSourceBehavior, 0, prio, this);
+    }
+
+    /**
+     * @brief Parse record starting at or after p, skipping CSV lines that do not start with a number
+     *
+     * @param p position in the mapped file
+     * @return false if there are no more records
+     */
+    bool TraceSource::parseRecord(const char* p)
+    {
+        const char* end = base + len;
+        if (format == Format::Binary)
+        {
+            if (p + recordSize > end)
+            {
+                cur = nullptr;
+                return false;
+            }
+            cur = p;
+            curEnd = p + recordSize;
+            memcpy(&curTime, p, sizeof(double));
+            return true;
+        }
+
+        while (p < end)
+        {
+            const char* nl = static_cast<const char*>(memchr(p, '\n', end - p));
+            const char* lineEnd = nl ? nl : end;
+            char buf[64];
+            size_t n = 0;
+            while (p + n < lineEnd && p[n] != ',' && p[n] != '\r' && n < sizeof(buf) - 1)
+            {
+                buf[n] = p[n];
+                n++;
+            }
+            buf[n] = '\0';
+            char* numEnd;
+            double t = strtod(buf, &numEnd);
+            if (n > 0 && numEnd == buf + n)
+            {
+                cur = p;
+                curEnd = lineEnd;
+                curTime = t;
+                return true;
+            }
+            p = nl ? nl + 1 : end;
+        }
+        cur = nullptr;
+        return false;
+    }
+
+    /**
+     * @brief Move to the next record
+     *
+     * @return false if there are no more records
+     */
+    bool TraceSource::advance()
+    {
+        if (!cur)
+            return false;
+        const char* next = format == Format::Binary ? curEnd : curEnd + 1;
+        release();
+        return parseRecord(next);
+    }
+
+    /**
+     * @brief Drop already replayed pages of the mapping from memory
+     *
+     * Pages are backed by the file, records of still living processes are read back on access
+     */
+    void TraceSource::release()
+    {
+        if ((size_t)(cur - released) < TRACE_RELEASE_BYTES)
+            return;
+        size_t page = sysconf(_SC_PAGESIZE);
+        const char* upTo = base + ((cur - base) / page) * page;
+        madvise(const_cast<char*>(released), upTo - released, MADV_DONTNEED);
+        released = upTo;
+    }
+
+    /**
+     * @brief Number of attributes of a record
+     *
+     * @param record process data of a process created by this source
+     * @return number of attributes after the time
+     */
+    int TraceSource::attributeCount(const void* record) const
+    {
+        if (format == Format::Binary)
+            return binAttributes;
+        const char* p = static_cast<const char*>(record);
+        const char* end = base + len;
+        int cnt = 0;
+        for (; p < end && *p != '\n'; p++)
+            if (*p == ',')
+                cnt++;
+        return cnt;
+    }
+
+    /**
+     * @brief Read attribute of a record
+     *
+     * @param record process data of a process created by this source
+     * @param index index of the attribute, 0 is the first value after the time
+     * @return value of the attribute
+     */
+    double TraceSource::attribute(const void* record, int index) const
+    {
+        const char* p = static_cast<const char*>(record);
+        if (format == Format::Binary)
+        {
+            if (index < 0 || index >= binAttributes)
+                throw std::out_of_range("Trace attribute index out of range");
+            double val;
+            memcpy(&val, p + sizeof(double) * (1 + index), sizeof(double));
+            return val;
+        }
+
+        const char* end = base + len;
+        if (index < 0)
+            throw std::out_of_range("Trace attribute index out of range");
+        for (int commas = 0; commas <= index; p++)
+        {
+            if (p >= end || *p == '\n')
+                throw std::out_of_range("Trace attribute index out of range");
+            if (*p == ',')
+                commas++;
+        }
+        char buf[64];
+        size_t n = 0;
+        while (p + n < end && p[n] != ',' && p[n] != '\n' && p[n] != '\r' && n < sizeof(buf) - 1)
+        {
+            buf[n] = p[n];
+            n++;
+        }
+        buf[n] = '\0';
+        return strtod(buf, nullptr);
+    }
+
+    /**
+     * @brief Behavior of the generator process of a TraceSource
+     *
+     * Creates a process for the current record and plans its own activation at the time of
+     * the next record. The generator process data must point to the TraceSource
+     *
+     * @param p generator process
+     * @param data unused
+     */
+    void traceSourceBehavior(Process* p, void* data)
+    {
+        TraceSource* src = static_cast<TraceSource*>(p->data);
+        Simulation* sim = p->sim;
+        sim->createProcess(src->behav, src->state, src->prio, const_cast<char*>(src->cur));
+        src->arrived++;
+        if (src->advance())
+        {
+            double now = sim->getTime();
+            sim->addProcessEvent(p->id, 0, src->curTime > now ? src->curTime : now, src->prio, now);
+        }
+        else
+            sim->terminateProcess(p->id);
+    }
+/**********TRACE SOURCE**********/
@@ -0,0 +1,77 @@
+/**
+ * @file traceSource.hpp
+ * @author Adam Hos <xhosad00>
+ * @brief Trace driven arrivals replayed lazily from a memory-mapped file
+ *
+ * Trace is either CSV text with one arrival per line
+ *
+ *     time[,attribute...]
+ *
+ * (lines not starting with a number, e.g. a header, are skipped) or binary, starting with
+ * magic "SHOTR001", uint32 attribute count, uint32 reserved, followed by records of
+ * (1 + attribute count) doubles in host byte order, time first. Records must be sorted by time,
+ * earlier records are replayed at the current time
+ */
+
+#ifndef TRACE_SOURCE_HPP
+#define TRACE_SOURCE_HPP
+
+#include "discreteSim.hpp"
+
+    /**
+     * @brief The TraceSource class creates a process for every record of a trace file
+     *
+     * The file is memory-mapped and only the next record is parsed, so there is always at most
+     * one look-ahead arrival planned in the calendar. Created processes get a pointer to their
+     * record as process data, attributes are read with attribute(). TraceSource must outlive
+     * the simulation run and the processes it created
+     */
+    class TraceSource
+    {
+    public:
+        /**
+         * @brief Trace file format
+         */
+        enum class Format {
+            CSV,        ///< Text, one record per line
+            Binary      ///< Fixed size records of doubles
+        };
+
+        explicit TraceSource(const std::string& path);
+        ~TraceSource();
+        TraceSource(const TraceSource&) = delete;
+        TraceSource& operator=(const TraceSource&) = delete;
+
+        bool isOpen() const;
+        Format getFormat() const;
+        bool start(Simulation* sim, void (*behav)(Process*, void*), int state = 0, int prio = CREATE_PROCESS_PRIO);
+        unsigned long arrivals() const;
+
+        int attributeCount(const void* record) const;
+        double attribute(const void* record, int index) const;
+
+    private:
+        const char* base;       ///< Start of the mapped file, nullptr if not open
+        size_t len;             ///< Length of the mapped file
+        Format format;          ///< Format of the trace
+        size_t recordSize;      ///< Size of a binary record
+        int binAttributes;      ///< Attribute count of binary records
+        const char* cur;        ///< Current record, nullptr after the last one
+        const char* curEnd;     ///< End of the current record
+        double curTime;         ///< Time of the current record
+        const char* released;   ///< Mapped memory before this pointer was released from memory
+        unsigned long arrived;  ///< Number of created processes
+        void (*behav)(Process*, void*);     ///< Behavior of created processes
+        int state;              ///< Initial state of created processes
+        int prio;               ///< Priority of creating a process
+
+        bool parseRecord(const char* p);
+        bool advance();
+        void release();
+
+        friend void traceSourceBehavior(Process* p, void* data);
+    };
+
+    void traceSourceBehavior(Process* p, void* data);
+
+#endif // TRACE_SOURCE_HPP
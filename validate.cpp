@@ -0,0 +1,607 @@
+/**
+ * @file validate.cpp
+ * @author Adam Hos <xhosad00>
+ * @brief Validation of Facility statistics against closed-form queueing theory results
+ *
+ * Every model is run in independent replications, statistics are collected after a warm-up
+ * period and the replication mean of mean wait, utilization and mean queue length is compared
+ * to the analytic value using a 99.9% confidence interval. The same models are run through the
+ * lockstep Ensemble, which must also agree exactly with Simulation on a deterministic line.
+ * Sample mean and variance of every distribution type are checked against analytic values.
+ * Channels are checked on a producer faster than its consumer. Splitting estimate of a queue
+ * overflow probability is compared with plain replications of the same model. A run must
+ * stop with events planned exactly at its end time executed and later ones not.
+ * Returns non-zero if any check fails
+ */
+
+#include "discreteSim.hpp"
+#include "channel.hpp"
+#include "ensemble.hpp"
+#include "splitting.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+const bool Verbose = false;
+
+const int REPLICATIONS = 10;            ///< Number of independent replications of every model
+const double T_QUANTILE = 4.781;        ///< Student t quantile 0.9995 for REPLICATIONS - 1 degrees of freedom
+const double WARMUP = 2000;             ///< Length of the warm-up period, statistics are reset after it
+const double RUN_LENGTH = 60000;        ///< Length of the measured period
+
+/**
+ * @brief Analytic results of one facility
+ */
+struct QueueTheory
+{
+    double wait;        ///< Mean waiting time in queue
+    double util;        ///< Server utilization
+    double queueLen;    ///< Mean queue length
+};
+
+/**
+ * @brief Measured results of one facility over all replications
+ */
+struct QueueSamples
+{
+    std::vector<double> wait;       ///< Mean waiting time per replication
+    std::vector<double> util;       ///< Utilization per replication
+    std::vector<double> queueLen;   ///< Time average queue length per replication, not checked if empty
+};
+
+static int failed = 0;  ///< Number of failed checks
+
+/**
+ * @brief Behavior of a process resetting facility statistics at the end of warm-up
+ */
+static void warmupBehavior(Process* p, void* data)
+{
+    for (auto& f : p->sim->facMap)
+        f.second.resetStats();
+    p->sim->terminateProcess(p->id);
+}
+
+/**
+ * @brief Compare replication mean with the analytic value and print the result
+ *
+ * @param model name of the model
+ * @param metric name of the metric
+ * @param samples one value per replication
+ * @param expected analytic value
+ */
+static void check(const std::string& model, const char* metric, const std::vector<double>& samples, double expected)
+{
+    double mean = 0;
+    for (double v : samples)
+        mean += v;
+    mean /= samples.size();
+    double var = 0;
+    for (double v : samples)
+        var += (v - mean) * (v - mean);
+    var /= samples.size() - 1;
+    double half = T_QUANTILE * std::sqrt(var / samples.size());
+    bool ok = std::fabs(mean - expected) <= half;
+    if (!ok)
+        failed++;
+    printf("%-22s %-10s theory %9.4f  sim %9.4f +- %7.4f  %s\n", model.c_str(), metric, expected, mean, half, ok ? "OK" : "FAIL");
+}
+
+/**
+ * @brief Add measured statistics of one facility in one replication
+ *
+ * @param samples samples of the facility
+ * @param stats facility statistics collected over RUN_LENGTH
+ * @param servers capacity of the facility
+ */
+static void addSample(QueueSamples& samples, const Facility::FacilityStats& stats, int servers)
+{
+    samples.wait.push_back(stats.waitTimeTotal / stats.processCnt);
+    samples.util.push_back(stats.workTimeTotal / (servers * RUN_LENGTH));
+}
+
+/**
+ * @brief Add queue length of one facility in one replication
+ *
+ * @param samples samples of the facility
+ * @param queueArea integral of the queue length over RUN_LENGTH
+ */
+static void addQueueSample(QueueSamples& samples, double queueArea)
+{
+    samples.queueLen.push_back(queueArea / RUN_LENGTH);
+}
+
+/**
+ * @brief Check samples of every facility of a line against its analytic results
+ */
+static void checkSamples(const std::string& model, const std::vector<QueueSamples>& samples, const std::vector<QueueTheory>& theory)
+{
+    for (size_t i = 0; i < theory.size(); i++)
+    {
+        std::string name = theory.size() > 1 ? model + " F" + std::to_string(i) : model;
+        check(name, "wait", samples[i].wait, theory[i].wait);
+        check(name, "util", samples[i].util, theory[i].util);
+        if (!samples[i].queueLen.empty())
+            check(name, "queueLen", samples[i].queueLen, theory[i].queueLen);
+    }
+}
+
+/**
+ * @brief Run replications of a line of facilities fed by one Poisson source
+ *
+ * One Simulation is reset between replications. Queue length is integrated over time from
+ * the queue size between events, independently of the wait time statistics
+ *
+ * @param model name of the model
+ * @param lambda arrival rate
+ * @param servers capacity of the facilities
+ * @param service service time distribution
+ * @param theory analytic result for each facility of the line
+ */
+static void validateLine(const std::string& model, double lambda, int servers, const Distribution& service, const std::vector<QueueTheory>& theory)
+{
+    std::vector<QueueSamples> samples(theory.size());
+    Simulation sim;
+    for (int r = 0; r < REPLICATIONS; r++)
+    {
+        sim.reset();
+        sim.createArrivalSource(0, Facility::GenType::Exp, lambda, 0);
+        ArrivalSource* src = sim.findArrivalSource(0);
+        std::vector<Facility*> stages;
+        for (size_t i = 0; i < theory.size(); i++)
+        {
+            sim.createFacility(i, "Stage", servers, service);
+            src->route.push_back(i);
+            stages.push_back(sim.findFacility(i));
+        }
+        sim.createProcessAtTime(WARMUP, warmupBehavior);
+        sim.setEndTime(WARMUP + RUN_LENGTH);
+        std::vector<double> area(theory.size(), 0);
+        double last = WARMUP;   // queue sizes hold from the last executed event until the next one
+        while (!sim.finished())
+        {
+            Event e = sim.nextEvent();
+            if (sim.getTime() > last)
+            {
+                for (size_t i = 0; i < stages.size(); i++)
+                    area[i] += stages[i]->q.size() * (sim.getTime() - last);
+                last = sim.getTime();
+            }
+            sim.executeEvent(e);
+        }
+
+        for (size_t i = 0; i < theory.size(); i++)
+        {
+            area[i] += stages[i]->q.size() * (WARMUP + RUN_LENGTH - last);
+            addSample(samples[i], stages[i]->stats, servers);
+            addQueueSample(samples[i], area[i]);
+        }
+    }
+    checkSamples(model, samples, theory);
+}
+
+/**
+ * @brief Run the same line as validateLine through the lockstep Ensemble, one lane per replication
+ */
+static void validateEnsemble(const std::string& model, double lambda, int servers, Facility::GenType g, double a, double b, const std::vector<QueueTheory>& theory)
+{
+    std::vector<QueueSamples> samples(theory.size());
+    Ensemble ens(REPLICATIONS, SEED);
+    ens.setArrivals(Facility::GenType::Exp, lambda, 0);
+    for (size_t i = 0; i < theory.size(); i++)
+        ens.addStage(servers, g, a, b);
+    ens.run(WARMUP + RUN_LENGTH, WARMUP);
+    for (int r = 0; r < REPLICATIONS; r++)
+        for (size_t i = 0; i < theory.size(); i++)
+        {
+            addSample(samples[i], ens.stats(r, i), servers);
+            addQueueSample(samples[i], ens.queueArea(r, i));
+        }
+    checkSamples("Ensemble " + model, samples, theory);
+}
+
+/**
+ * @brief Compare Ensemble loaded by loadRoute with Simulation on a deterministic line, statistics must be equal
+ *
+ * @param start time of the first arrival
+ * @param limit maximal number of arrivals, -1 if unlimited
+ */
+static void validateEnsembleExact(double start, int limit)
+{
+    const double endTime = 1000.5;
+    const double service[] = {0.7, 1.9, 0.4};
+    Simulation sim;
+    Ensemble ens(3, SEED);
+    sim.createArrivalSource(0, Facility::GenType::Deterministic, 1.0, 0, start, limit);
+    for (int i = 0; i < 3; i++)
+    {
+        sim.createFacility(i, "Stage", i == 2 ? 2 : 1, Facility::GenType::Deterministic, service[i], 0);
+        sim.findArrivalSource(0)->route.push_back(i);
+    }
+    int mismatches = ens.loadRoute(&sim, 0) ? 0 : 1;
+    sim.setEndTime(endTime);
+    while (!sim.finished())
+    {
+        Event e = sim.nextEvent();
+        sim.executeEvent(e);
+    }
+    ens.run(endTime);
+
+    for (int i = 0; i < 3; i++)
+    {
+        const Facility::FacilityStats& s = sim.findFacility(i)->stats;
+        for (int r = 0; r < ens.replications(); r++)
+        {
+            Facility::FacilityStats e = ens.stats(r, i);
+            bool ok = e.processCnt == s.processCnt && std::fabs(e.waitTimeTotal - s.waitTimeTotal) < 1e-6 && std::fabs(e.workTimeTotal - s.workTimeTotal) < 1e-6;
+            if (!ok)
+            {
+                mismatches++;
+                printf("Ensemble exact F%d rep %d: cnt %d/%d wait %.4f/%.4f work %.4f/%.4f  FAIL\n", i, r,
+                    e.processCnt, s.processCnt, e.waitTimeTotal, s.waitTimeTotal, e.workTimeTotal, s.workTimeTotal);
+            }
+        }
+    }
+    if (mismatches)
+        failed++;
+    std::string name = "Ensemble exact" + (limit >= 0 ? " limit=" + std::to_string(limit) : std::string());
+    printf("%-22s %-10s %s\n", name.c_str(), "stats", mismatches ? "FAILED" : "OK");
+}
+
+/**
+ * @brief Compare sample mean and variance of a distribution with its analytic values
+ *
+ * @param name name of the distribution
+ * @param d distribution
+ */
+static void validateDistribution(const std::string& name, Distribution d)
+{
+    const int n = 200000;
+    std::vector<double> means, vars;
+    for (int r = 0; r < REPLICATIONS; r++)
+    {
+        double sum = 0, sum2 = 0;
+        for (int i = 0; i < n; i++)
+        {
+            double x = d.sample();
+            sum += x;
+            sum2 += x * x;
+        }
+        double m = sum / n;
+        means.push_back(m);
+        vars.push_back(sum2 / n - m * m);
+    }
+    check(name, "mean", means, d.mean());
+    check(name, "variance", vars, d.variance());
+}
+
+/**
+ * @brief Analytic results of M/G/1 queue (Pollaczek-Khinchine formula)
+ *
+ * @param lambda arrival rate
+ * @param service service time distribution
+ */
+static QueueTheory mg1Theory(double lambda, const Distribution& service)
+{
+    double mean = service.mean();
+    double rho = lambda * mean;
+    double wait = lambda * (service.variance() + mean * mean) / (2 * (1 - rho));
+    QueueTheory t = {wait, rho, lambda * wait};
+    return t;
+}
+
+static const int CHANNEL_MESSAGES = 1000;  ///< Number of messages sent by the channel producer
+static Channel<int>* chan;          ///< Channel between the producer and the consumer
+static int chanNext;                ///< Next value sent by the producer
+static int chanExpected;            ///< Next value expected by the consumer
+static int chanValue;               ///< Message received by the consumer
+static bool chanOrdered;            ///< False if a message was received out of order
+static size_t chanMaxBuffered;      ///< Highest number of buffered messages
+static size_t chanMaxBlocked;       ///< Highest number of blocked senders
+
+/**
+ * @brief Producer sending one message per time unit
+ */
+static void producerBehavior(Process* p, void* data)
+{
+    switch (p->state)
+    {
+        case 0:
+            chan->send(p, chanNext, 1);
+            chanMaxBuffered = std::max(chanMaxBuffered, chan->size());
+            chanMaxBlocked = std::max(chanMaxBlocked, chan->blockedSenders());
+            break;
+        case 1:
+            if (++chanNext < CHANNEL_MESSAGES)
+                p->sim->waitFor(p->id, 0, 1.0);
+            else
+                p->sim->terminateProcess(p->id);
+            break;
+    }
+}
+
+/**
+ * @brief Consumer spending three time units on every message
+ */
+static void consumerBehavior(Process* p, void* data)
+{
+    switch (p->state)
+    {
+        case 0:
+            chan->receive(p, 1, &chanValue);
+            break;
+        case 1:
+            if (chanValue != chanExpected++)
+                chanOrdered = false;
+            p->sim->waitFor(p->id, 0, 3.0);
+            break;
+    }
+}
+
+/**
+ * @brief Check order, buffering and back-pressure of a channel between a fast producer and a slow consumer
+ *
+ * @param capacity capacity of the channel, -1 if unbounded
+ */
+static void validateChannel(int capacity)
+{
+    Simulation sim;
+    Channel<int> c(&sim, capacity);
+    chan = &c;
+    chanNext = chanExpected = 0;
+    chanOrdered = true;
+    chanMaxBuffered = chanMaxBlocked = 0;
+    sim.createProcess(producerBehavior);
+    sim.createProcess(consumerBehavior);
+    while (!sim.finished())
+    {
+        Event e = sim.nextEvent();
+        sim.executeEvent(e);
+    }
+
+    // the consumer sets the pace, it ends blocked in receive after the last message
+    bool ok = chanOrdered && chanExpected == CHANNEL_MESSAGES && sim.getTime() == 3.0 * CHANNEL_MESSAGES && c.blockedReceivers() == 1;
+    if (capacity >= 0)
+        ok = ok && chanMaxBuffered <= (size_t)capacity && chanMaxBlocked == 1;
+    else
+        ok = ok && chanMaxBlocked == 0;
+    if (!ok)
+        failed++;
+    std::string name = "Channel cap=" + std::to_string(capacity);
+    printf("%-22s %-10s received %d ordered %d end %.1f max buffered %zu max blocked %zu  %s\n", name.c_str(), "flow",
+        chanExpected, chanOrdered, sim.getTime(), chanMaxBuffered, chanMaxBlocked, ok ? "OK" : "FAIL");
+}
+
+/**
+ * @brief Compare fixed effort splitting with plain replications on M/M/1 queue overflow
+ *
+ * Both estimate the probability that the queue of M/M/1 with rho 0.5 reaches 8 waiting
+ * processes before time 100, plain replications run from clones of the same initial state
+ */
+static void validateSplitting()
+{
+    const double horizon = 100;
+    const size_t length = 8;
+    const int plainRuns = 20000;
+    Simulation initial;
+    initial.createArrivalSource(0, Facility::GenType::Exp, 0.5, 0);
+    initial.createFacility(0, "Queue", 1, Facility::GenType::Exp, 1.0, 0);
+    initial.findArrivalSource(0)->route.push_back(0);
+    initial.setEndTime(horizon);
+
+    long events = 0;
+    int hits = 0;
+    for (int i = 0; i < plainRuns; i++)
+    {
+        Simulation run(initial);
+        hits += runUntilQueue(run, run.findFacility(0), length, events);
+    }
+    double plain = (double)hits / plainRuns;
+    double plainVar = plain * (1 - plain) / plainRuns;
+
+    SplittingResult res = fixedEffortSplitting(initial, 0, {2, 4, 6, 8}, horizon, 500, REPLICATIONS);
+    double half = 3.29 * std::sqrt(plainVar + res.variance);     // normal quantile 0.9995
+    bool ok = std::fabs(res.probability - plain) <= half;
+    if (!ok)
+        failed++;
+    printf("%-22s %-10s plain %9.5f  split %9.5f +- %7.5f  %s\n", "Splitting M/M/1 q>=8", "prob", plain, res.probability, half, ok ? "OK" : "FAIL");
+}
+
+static double tickTimes[2];  ///< Simulation time when the stepping and the direct process finished
+static int tickOrder[2];    ///< IDs of the two processes in the order they finished
+static int tickFinished;    ///< Number of finished processes
+
+/**
+ * @brief Process reaching time 1 in steps of equal length (number of steps in process data), then recording when it finished
+ */
+static void tickBehavior(Process* p, void* data)
+{
+    int steps = (int)(intptr_t)p->data;
+    if (p->state < steps)
+    {
+        p->sim->waitFor(p->id, p->state + 1, 1.0 / steps);
+        return;
+    }
+    tickTimes[steps == 1] = p->sim->getTime();
+    tickOrder[tickFinished++] = steps;
+    p->sim->terminateProcess(p->id);
+}
+
+/**
+ * @brief Check that sums of delays reaching the same time tie exactly with integer tick time
+ *
+ * Ten waits of 0.1 sum to 0.9999999999999999 in double, with ticks they end at 1 together
+ * with a single wait of 1 and the tie is broken by planning order. Only reported with double time
+ */
+static void validateTickTime()
+{
+    Simulation sim;
+    tickFinished = 0;
+    sim.createProcess(tickBehavior, 0, CREATE_PROCESS_PRIO, (void*)(intptr_t)10);
+    sim.createProcess(tickBehavior, 0, CREATE_PROCESS_PRIO, (void*)(intptr_t)1);
+    while (!sim.finished())
+    {
+        Event e = sim.nextEvent();
+        sim.executeEvent(e);
+    }
+#ifdef DISCSIM_TICK_TIME
+    // both end in the same tick, the direct process was planned first with the same priority
+    bool ok = tickFinished == 2 && tickTimes[0] == tickTimes[1] && tickTimes[0] == 1.0 && tickOrder[0] == 1;
+    if (!ok)
+        failed++;
+    const char* status = ok ? "OK" : "FAIL";
+#else
+    const char* status = "not checked with double time";
+#endif
+    printf("%-22s %-10s stepped %.17g  direct %.17g  first %s  %s\n", "Tick time ties", "exact",
+        tickTimes[0], tickTimes[1], tickOrder[0] == 1 ? "direct" : "stepped", status);
+}
+
+static const double END_TIME = 2.0;  ///< End time of the end time check
+static int endAt;       ///< Events executed at END_TIME
+static int endAfter;    ///< Events executed after END_TIME
+
+/**
+ * @brief Process reaching END_TIME exactly, planning a zero delay activation there and a wait past it
+ */
+static void endTimeBehavior(Process* p, void* data)
+{
+    switch (p->state)
+    {
+        case 0:
+            p->sim->waitFor(p->id, 1, END_TIME);
+            break;
+        case 1:
+            endAt++;
+            p->sim->activate(p->id, 2);
+            break;
+        case 2:
+            endAt++;
+            p->sim->waitFor(p->id, 3, 0.5);
+            break;
+        default:
+            endAfter++;
+            p->sim->terminateProcess(p->id);
+            break;
+    }
+}
+
+/**
+ * @brief Check that events planned exactly at the end time run and the first later event does not
+ *
+ * finished() looks at the time of the next planned event, so the run stops with the clock at the
+ * end time, both in double and tick time
+ */
+static void validateEndTime()
+{
+    Simulation sim;
+    endAt = 0;
+    endAfter = 0;
+    sim.setEndTime(END_TIME);
+    sim.createProcess(endTimeBehavior);
+    sim.createProcessAtTime(END_TIME + 0.25, endTimeBehavior, 3);
+    while (!sim.finished())
+    {
+        Event e = sim.nextEvent();
+        sim.executeEvent(e);
+    }
+    bool ok = endAt == 2 && endAfter == 0 && sim.getTime() == END_TIME;
+    if (!ok)
+        failed++;
+    printf("%-22s %-10s at end %d  after end %d  clock %g  %s\n", "End time", "events", endAt, endAfter, sim.getTime(), ok ? "OK" : "FAIL");
+}
+
+/**
+ * @brief Analytic results of M/M/c queue (Erlang C formula)
+ *
+ * @param lambda arrival rate
+ * @param mu service rate of one server
+ * @param c number of servers
+ */
+static QueueTheory mmcTheory(double lambda, double mu, int c)
+{
+    double load = lambda / mu;
+    double rho = load / c;
+    double term = 1;    // load^k / k!
+    double sum = 0;
+    for (int k = 0; k < c; k++)
+    {
+        sum += term;
+        term *= load / (k + 1);
+    }
+    double tail = term / (1 - rho);
+    double erlangC = tail / (sum + tail);
+    double wait = erlangC / (c * mu - lambda);
+    QueueTheory t = {wait, rho, lambda * wait};
+    return t;
+}
+
+/**
+ * @brief Analytic results of M/D/1 queue (Pollaczek-Khinchine formula)
+ *
+ * @param lambda arrival rate
+ * @param d constant service time
+ */
+static QueueTheory md1Theory(double lambda, double d)
+{
+    double rho = lambda * d;
+    double wait = rho * d / (2 * (1 - rho));
+    QueueTheory t = {wait, rho, lambda * wait};
+    return t;
+}
+
+int main(int argc, char* argv[])
+{
+    if (parseArguments(argc, argv, SEED))
+        return 1;
+
+    Distribution exp1(GenType::Exp, 1.0, 0);
+    validateLine("M/M/1 rho=0.5", 0.5, 1, exp1, {mmcTheory(0.5, 1.0, 1)});
+    validateLine("M/M/1 rho=0.8", 0.8, 1, exp1, {mmcTheory(0.8, 1.0, 1)});
+    validateLine("M/M/3 rho=0.7", 2.1, 3, exp1, {mmcTheory(2.1, 1.0, 3)});
+    validateLine("M/D/1 rho=0.7", 0.7, 1, Distribution(GenType::Deterministic, 1.0, 0), {md1Theory(0.7, 1.0)});
+    // Jackson network: every stage of a tandem line with exponential service is M/M/1
+    validateLine("Jackson tandem", 0.6, 1, exp1, std::vector<QueueTheory>(3, mmcTheory(0.6, 1.0, 1)));
+    Distribution erlang(GenType::Erlang, 4, 4.0);
+    validateLine("M/E4/1 rho=0.7", 0.7, 1, erlang, {mg1Theory(0.7, erlang)});
+    Distribution hyper = Distribution::hyperExp({0.9, 0.1}, {1.8, 0.2});
+    validateLine("M/H2/1 rho=0.5", 0.5 / hyper.mean(), 1, hyper, {mg1Theory(0.5 / hyper.mean(), hyper)});
+
+    validateDistribution("uniform", Distribution(GenType::Uniform, 1.0, 3.0));
+    validateDistribution("normal clamped", Distribution(GenType::Normal, 0.5, 1.0));
+    validateDistribution("erlang", erlang);
+    validateDistribution("lognormal", Distribution(GenType::LogNormal, 0, 0.5));
+    validateDistribution("empirical", Distribution::empirical({0, 1, 2, 5}, {3, 1, 0.5}));
+    validateDistribution("discrete", Distribution::discrete({1, 2, 10}, {0.7, 0.2, 0.1}));
+    validateDistribution("hyperexp", hyper);
+    validateDistribution("phase", Distribution::phaseType({0.6, 0.4}, {2, 5}, {3.0, 1.0}));
+
+    validateEnsemble("M/M/1 rho=0.8", 0.8, 1, Facility::GenType::Exp, 1.0, 0, {mmcTheory(0.8, 1.0, 1)});
+    validateEnsemble("M/M/3 rho=0.7", 2.1, 3, Facility::GenType::Exp, 1.0, 0, {mmcTheory(2.1, 1.0, 3)});
+    validateEnsemble("M/D/1 rho=0.7", 0.7, 1, Facility::GenType::Deterministic, 1.0, 0, {md1Theory(0.7, 1.0)});
+    validateEnsemble("Jackson tandem", 0.6, 1, Facility::GenType::Exp, 1.0, 0, std::vector<QueueTheory>(3, mmcTheory(0.6, 1.0, 1)));
+    // product of 800 uniforms underflows, phases are combined in chunks
+    Distribution erlang800(GenType::Erlang, 800, 800.0);
+    validateEnsemble("M/E800/1 rho=0.7", 0.7, 1, Facility::GenType::Erlang, 800, 800.0, {mg1Theory(0.7, erlang800)});
+    validateEnsembleExact(0, -1);
+    validateEnsembleExact(0.25, 700);
+
+    validateChannel(-1);
+    validateChannel(2);
+    validateChannel(0);
+
+    validateSplitting();
+
+    validateTickTime();
+    validateEndTime();
+
+    if (failed)
+    {
+        printf("%d checks FAILED\n", failed);
+        return 1;
+    }
+    printf("all checks passed\n");
+    return 0;
+}